@@ -0,0 +1,420 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/startup_trace.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Bytes of an asset, either a span of the mounted pack / a mapped loose file or a decompressed copy.
+// data keeps whatever backs the bytes alive, so it can be aliased by shared_ptrs into the asset.
+struct AssetBlob {
+    shared_ptr<const unsigned char> data;
+    size_t size = 0;
+    bool packed = false; // came from the asset pack, see AssetPack::Find
+
+    explicit operator bool() const { return data != nullptr; }
+};
+
+// LZ4 style block compression: sequences of a token (literal length << 4 | match length - 4), the literals
+// and a 16 bit back reference. Lengths of 15 and more continue in bytes of 255. Fast to decode, meant for the
+// text and binary entries of the asset pack; images are already compressed and are stored as they are.
+inline string LzCompress(const unsigned char *src, size_t size)
+{
+    const size_t MinMatch = 4, LastLiterals = 5, MaxOffset = 65535;
+    const int HashBits = 14;
+    vector<uint32_t> table(1 << HashBits, 0); // position + 1 of the last 4 bytes with that hash, 0 if none
+    string out;
+    out.reserve(size / 2 + 16);
+
+    auto read32 = [src](size_t pos) { uint32_t value; memcpy(&value, src + pos, 4); return value; };
+    auto putLength = [&out](size_t length) {
+        for (; length >= 255; length -= 255)
+            out.push_back((char)255);
+        out.push_back((char)length);
+    };
+    auto emit = [&](size_t literalStart, size_t literalLength, size_t offset, size_t matchLength) {
+        size_t matchCode = matchLength ? matchLength - MinMatch : 0;
+        out.push_back((char)((min(literalLength, (size_t)15) << 4) | min(matchCode, (size_t)15)));
+        if (literalLength >= 15)
+            putLength(literalLength - 15);
+        out.append((const char *)src + literalStart, literalLength);
+        if (!matchLength)
+            return;
+        out.push_back((char)(offset & 0xff));
+        out.push_back((char)(offset >> 8));
+        if (matchCode >= 15)
+            putLength(matchCode - 15);
+    };
+
+    size_t anchor = 0, pos = 0;
+    while (pos + MinMatch + LastLiterals <= size)
+    {
+        uint32_t sequence = read32(pos);
+        uint32_t &slot = table[(sequence * 2654435761u) >> (32 - HashBits)];
+        size_t candidate = slot;
+        slot = (uint32_t)(pos + 1);
+        if (candidate == 0 || pos - (candidate - 1) > MaxOffset || read32(candidate - 1) != sequence)
+        {
+            pos++;
+            continue;
+        }
+        candidate--;
+        size_t length = MinMatch;
+        while (pos + length + LastLiterals < size && src[candidate + length] == src[pos + length])
+            length++;
+        emit(anchor, pos - anchor, pos - candidate, length);
+        pos += length;
+        anchor = pos;
+    }
+    emit(anchor, size - anchor, 0, 0);
+    return out;
+}
+
+// decodes an LzCompress block into dst, which must hold exactly rawSize bytes; false on malformed input.
+inline bool LzDecompress(const unsigned char *src, size_t size, unsigned char *dst, size_t rawSize)
+{
+    const unsigned char *ip = src, *end = src + size;
+    size_t op = 0;
+    auto getLength = [&ip, end](size_t &length) {
+        unsigned char byte;
+        do
+        {
+            if (ip >= end)
+                return false;
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (ip < end)
+    {
+        unsigned char token = *ip++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !getLength(literalLength))
+            return false;
+        if ((size_t)(end - ip) < literalLength || rawSize - op < literalLength)
+            return false;
+        memcpy(dst + op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+        if (ip == end)
+            break; // the last sequence has no match
+
+        if (end - ip < 2)
+            return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !getLength(matchLength))
+            return false;
+        matchLength += 4;
+        if (offset == 0 || offset > op || rawSize - op < matchLength)
+            return false;
+        // byte by byte, a match may overlap the bytes it produces
+        for (size_t i = 0; i < matchLength; i++, op++)
+            dst[op] = dst[op - offset];
+    }
+    return op == rawSize;
+}
+
+// Read-only archive of many assets in a single file: a header, the entries each starting on a 4 KiB boundary and
+// a table of contents sorted by name at the end. The pack is mapped once and the whole file is prefetched
+// sequentially, so loading from it replaces many small random reads with one streaming read. Stored entries are
+// handed out as spans of the mapping without copying; compressed ones are decoded into their own buffer.
+// Entry names are paths relative to the project root, e.g. "resources/objects/tenk/Body 1.jpg".
+class AssetPack
+{
+public:
+    static const uint32_t Version = 1;
+    static const size_t Alignment = 4096;
+
+    enum Compression : uint32_t { Stored = 0, Lz = 1 };
+
+    // opens packPath; absolute paths under rootDirectory are looked up relative to it. False if it's missing or unusable.
+    bool Open(const string &packPath, const string &rootDirectory)
+    {
+        file = make_shared<MappedFile>(packPath);
+        if (!file->valid())
+            return false;
+        if (file->size < sizeof(Header))
+            return fail(packPath, "truncated");
+        memcpy(&header, file->data, sizeof(header));
+        if (memcmp(header.magic, magicTag(), sizeof(header.magic)) != 0 || header.version != Version)
+            return fail(packPath, "bad header");
+        if (header.tocOffset > file->size || (file->size - header.tocOffset) / sizeof(Entry) < header.entryCount
+            || header.namesOffset > file->size || file->size - header.namesOffset < header.namesSize)
+            return fail(packPath, "truncated");
+
+        entries.resize(header.entryCount);
+        memcpy(entries.data(), file->data + header.tocOffset, entries.size() * sizeof(Entry));
+        for (const Entry &entry : entries)
+        {
+            if (entry.nameOffset > header.namesSize || header.namesSize - entry.nameOffset < entry.nameLength
+                || entry.offset > file->size || file->size - entry.offset < entry.size || entry.compression > Lz)
+                return fail(packPath, "corrupt table of contents");
+        }
+
+        // one sequential read of the whole pack instead of faulting pages in as assets are touched
+        madvise((void *)file->data, file->size, MADV_SEQUENTIAL);
+        madvise((void *)file->data, file->size, MADV_WILLNEED);
+
+        struct stat st;
+        writtenAt = stat(packPath.c_str(), &st) == 0 ? modifiedAt(st) : 0;
+        roots.clear();
+        roots.push_back(withSlash(rootDirectory));
+        char resolved[PATH_MAX];
+        if (realpath(rootDirectory.c_str(), resolved) && withSlash(resolved) != roots[0])
+            roots.push_back(withSlash(resolved));
+        return true;
+    }
+
+    // the asset stored under path (absolute under the root or already relative), or an empty blob. Also empty if
+    // the loose file at path was modified after the pack was written: the file is then newer than the entry and
+    // the caller reads it instead, so edits (and hot reloading them) work with a pack mounted.
+    AssetBlob Find(const string &path) const
+    {
+        AssetBlob blob;
+        const Entry *entry = lookup(relativeName(path));
+        if (!entry || editedSincePacked(path))
+            return blob;
+
+        blob.packed = true;
+        blob.size = entry->rawSize;
+        const unsigned char *bytes = file->data + entry->offset;
+        if (entry->compression == Stored)
+        {
+            blob.data = shared_ptr<const unsigned char>(file, bytes);
+            return blob;
+        }
+
+        shared_ptr<unsigned char> decoded(new unsigned char[max(entry->rawSize, (uint64_t)1)], default_delete<unsigned char[]>());
+        if (!LzDecompress(bytes, entry->size, decoded.get(), entry->rawSize))
+        {
+            cout << "ASSET_PACK:: corrupt entry " << nameOf(*entry) << endl;
+            return AssetBlob();
+        }
+        blob.data = decoded;
+        return blob;
+    }
+
+    bool Contains(const string &path) const { return lookup(relativeName(path)) != nullptr; }
+
+    size_t Size() const { return entries.size(); }
+
+    // writes a pack of the files at root/name for every name; entries that compress to less than 7/8 of their size
+    // are stored compressed when compress is set. Returns false if a file couldn't be read or the pack written.
+    static bool Write(const string &packPath, const string &root, vector<string> names, bool compress)
+    {
+        sort(names.begin(), names.end());
+        names.erase(unique(names.begin(), names.end()), names.end());
+
+        Header header;
+        memcpy(header.magic, magicTag(), sizeof(header.magic));
+        header.version = Version;
+        header.entryCount = (uint32_t)names.size();
+
+        string data(Alignment, '\0'); // room for the header
+        string nameTable;
+        vector<Entry> toc;
+        for (const string &name : names)
+        {
+            string path = withSlash(root) + name;
+            MappedFile source(path);
+            if (!source.valid() && access(path.c_str(), R_OK) != 0) // an empty file maps to nothing but is fine
+            {
+                cout << "ASSET_PACK:: can't read " << name << endl;
+                return false;
+            }
+
+            Entry entry;
+            entry.offset = data.size();
+            entry.rawSize = source.size;
+            entry.nameOffset = (uint32_t)nameTable.size();
+            entry.nameLength = (uint32_t)name.size();
+            nameTable += name;
+
+            string packed;
+            if (compress && source.size > 0)
+                packed = LzCompress(source.data, source.size);
+            if (!packed.empty() && packed.size() < source.size - source.size / 8)
+            {
+                entry.compression = Lz;
+                entry.size = packed.size();
+                data += packed;
+            }
+            else
+            {
+                entry.compression = Stored;
+                entry.size = source.size;
+                data.append((const char *)source.data, source.size);
+            }
+            data.resize((data.size() + Alignment - 1) / Alignment * Alignment, '\0');
+            toc.push_back(entry);
+        }
+
+        header.tocOffset = data.size();
+        header.namesOffset = header.tocOffset + toc.size() * sizeof(Entry);
+        header.namesSize = nameTable.size();
+        memcpy(&data[0], &header, sizeof(header));
+        return WriteFileAtomic(packPath, {
+            { data.data(), data.size() },
+            { toc.data(), toc.size() * sizeof(Entry) },
+            { nameTable.data(), nameTable.size() } });
+    }
+
+    // The pack every loader reads through (see ReadAsset), or nullptr. Mount before any loading starts;
+    // it's not safe to mount or unmount while worker threads are reading assets.
+    static AssetPack *Mounted() { return mounted().get(); }
+
+    static bool Mount(const string &packPath, const string &rootDirectory)
+    {
+        unique_ptr<AssetPack> pack(new AssetPack());
+        if (!pack->Open(packPath, rootDirectory))
+            return false;
+        cout << "ASSET_PACK:: mounted " << packPath << " (" << pack->Size() << " entries)" << endl;
+        mounted() = std::move(pack);
+        return true;
+    }
+
+    static void Unmount() { mounted().reset(); }
+
+private:
+    static const char *magicTag() { return "LOGLPAK"; }
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t entryCount;
+        uint64_t tocOffset;
+        uint64_t namesOffset;
+        uint64_t namesSize;
+    };
+
+    struct Entry {
+        uint64_t offset;
+        uint64_t size;     // bytes in the pack
+        uint64_t rawSize;  // bytes once decompressed
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t compression;
+        uint32_t padding = 0;
+    };
+
+    shared_ptr<MappedFile> file;
+    Header header;
+    vector<Entry> entries;
+    vector<string> roots; // root directory as given and canonicalized, each with a trailing slash
+    uint64_t writtenAt = 0; // modification time of the pack in nanoseconds
+
+    static unique_ptr<AssetPack> &mounted()
+    {
+        static unique_ptr<AssetPack> pack;
+        return pack;
+    }
+
+    static uint64_t modifiedAt(const struct stat &st)
+    {
+        return (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+    }
+
+    // whether there's a loose file at path that is newer than the pack; one stat per packed asset read
+    bool editedSincePacked(const string &path) const
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 && modifiedAt(st) > writtenAt;
+    }
+
+    static string withSlash(const string &path)
+    {
+        return !path.empty() && path.back() != '/' ? path + '/' : path;
+    }
+
+    string relativeName(const string &path) const
+    {
+        for (const string &root : roots)
+        {
+            if (path.compare(0, root.size(), root) == 0)
+                return path.substr(root.size());
+        }
+        return path.compare(0, 2, "./") == 0 ? path.substr(2) : path;
+    }
+
+    string nameOf(const Entry &entry) const
+    {
+        return string((const char *)file->data + header.namesOffset + entry.nameOffset, entry.nameLength);
+    }
+
+    int compareName(const Entry &entry, const string &name) const
+    {
+        const char *entryName = (const char *)file->data + header.namesOffset + entry.nameOffset;
+        int order = memcmp(entryName, name.data(), min((size_t)entry.nameLength, name.size()));
+        if (order != 0)
+            return order;
+        return entry.nameLength < name.size() ? -1 : entry.nameLength > name.size() ? 1 : 0;
+    }
+
+    // binary search of the sorted table of contents
+    const Entry *lookup(const string &name) const
+    {
+        size_t low = 0, high = entries.size();
+        while (low < high)
+        {
+            size_t middle = (low + high) / 2;
+            int order = compareName(entries[middle], name);
+            if (order == 0)
+                return &entries[middle];
+            if (order < 0)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return nullptr;
+    }
+
+    static bool fail(const string &packPath, const char *reason)
+    {
+        cout << "ASSET_PACK:: can't open " << packPath << " (" << reason << ")" << endl;
+        return false;
+    }
+};
+
+// Bytes of the asset at path: from the mounted pack if it has an entry at least as new as the loose file, otherwise
+// the loose file mapped into memory. Safe to call from worker threads.
+inline AssetBlob ReadAsset(const string &path)
+{
+    // the file is mapped, most of the reading happens in whatever scope first touches the data
+    TraceScope scope("read file", path);
+    if (AssetPack *pack = AssetPack::Mounted())
+    {
+        AssetBlob blob = pack->Find(path);
+        if (blob)
+            return blob;
+    }
+
+    AssetBlob blob;
+    auto file = make_shared<MappedFile>(path);
+    if (file->valid())
+    {
+        blob.data = shared_ptr<const unsigned char>(file, file->data);
+        blob.size = file->size;
+    }
+    else if (access(path.c_str(), R_OK) == 0)
+        blob.data = shared_ptr<const unsigned char>(new unsigned char[1](), default_delete<unsigned char[]>()); // empty file
+    return blob;
+}
+#endif
@@ -0,0 +1,337 @@
+#ifndef ASSET_REGISTRY_H
+#define ASSET_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/model.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/thread_pool.h>
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+using namespace std;
+
+typedef shared_ptr<Model> ModelHandle;
+
+struct AssetStats {
+    unsigned int modelHits = 0;
+    unsigned int modelMisses = 0;
+    unsigned int textureHits = 0;
+    unsigned int textureMisses = 0;
+    unsigned int residentModels = 0;
+    unsigned int residentTextures = 0;
+    size_t vertexBytes = 0;     // vertex buffers of the resident models
+    size_t fullVertexBytes = 0; // what they would take in the full float format
+    unsigned int deferredTextures = 0; // material textures of resident models no drawn mesh has asked for yet
+};
+
+// Process wide, reference counted cache of models and textures keyed by their canonical path.
+// Asking for an asset that is already resident returns a handle to the same GPU resources. When the last
+// handle to an asset goes away its GL objects are queued for deletion and freed by the next CollectGarbage(),
+// which has to run on the GL thread (once per frame is enough). Whatever is left when the registry goes away is
+// freed by its destructor, so it has to be destroyed on the GL thread after the handles it gave out.
+// Resident assets can be reloaded in place after their files changed (Reload), handles already given out then
+// see the new version.
+class AssetRegistry : public TextureSource
+{
+public:
+    // vertex buffer layout of the models uploaded from now on
+    VertexFormat ModelVertexFormat = VertexFormat::Full;
+    // what models uploaded from now on keep of their geometry in memory
+    CpuRetention ModelRetention = CpuRetention::Release;
+    // when models uploaded from now on request their material textures
+    TextureLoading ModelTextureLoading = TextureLoading::Upfront;
+
+    // with a streamer, textures are streamed in over several frames instead of being uploaded in one go
+    explicit AssetRegistry(ThreadPool &pool, TextureUploadQueue *streamer = nullptr)
+        : pool(pool), streamer(streamer), loader(pool, streamer), graveyard(make_shared<Graveyard>()) {}
+
+    ~AssetRegistry() { CollectGarbage(); }
+
+    AssetRegistry(const AssetRegistry &) = delete;
+    AssetRegistry &operator=(const AssetRegistry &) = delete;
+
+    // starts importing a model on the pool so a later LoadModel() only has to upload it
+    void PrefetchModel(const string &path)
+    {
+        string key = CanonicalPath(path);
+        if (models.find(key) != models.end() && !models[key].expired())
+            return;
+        if (importing.find(key) == importing.end())
+            importing[key] = Model::ImportAsync(key, pool);
+    }
+
+    // returns the resident model for path, importing and uploading it first if needed. Without wait it returns
+    // nullptr instead of blocking while the import is still running on the pool. GL thread only.
+    ModelHandle LoadModel(const string &path, bool wait = true, bool gamma = false)
+    {
+        string key = CanonicalPath(path);
+        auto found = models.find(key);
+        if (found != models.end())
+        {
+            if (ModelHandle model = found->second.lock())
+            {
+                stats.modelHits++;
+                return model;
+            }
+        }
+
+        PrefetchModel(key);
+        if (!wait && importing[key].wait_for(chrono::seconds(0)) != future_status::ready)
+            return nullptr;
+        stats.modelMisses++;
+        ModelData data = importing[key].get(); // moved out of the future, the model takes it from there
+        importing.erase(key);
+
+        shared_ptr<Graveyard> graveyard = this->graveyard;
+        ModelHandle model(new Model(std::move(data), *this, gamma, ModelVertexFormat, ModelRetention, ModelTextureLoading), [graveyard](Model *model) { graveyard->Bury(model); });
+        models[key] = model;
+        return model;
+    }
+
+    // returns the resident texture for path, queueing it on the texture loader if needed. GL thread only.
+    TextureHandle LoadTexture(const string &path, TextureRole role = TextureRole::Colour)
+    {
+        string key = CanonicalPath(path);
+        auto found = textures.find(key);
+        if (found != textures.end())
+        {
+            if (TextureHandle texture = found->second.lock())
+            {
+                stats.textureHits++;
+                return texture;
+            }
+        }
+        stats.textureMisses++;
+
+        // hand out an aliasing handle so we notice when the last user lets go of it, the slot itself is kept
+        // alive by the deleter until CollectGarbage() lets go of it on the GL thread
+        TextureHandle slot = loader.Request(key, role);
+        shared_ptr<Graveyard> graveyard = this->graveyard;
+        TextureHandle texture(slot.get(), [slot, graveyard](TextureSlot *) { graveyard->Bury(slot); });
+        textures[key] = texture;
+        return texture;
+    }
+
+    TextureHandle Request(const string &path, TextureRole role = TextureRole::Colour) override
+    {
+        return LoadTexture(path, role);
+    }
+
+    unsigned int Placeholder() const override { return loader.Placeholder(); }
+
+    // GL thread: uploads the textures that have finished decoding
+    void UploadReady() { loader.UploadReady(); }
+
+    // GL thread: waits for all queued textures and uploads them
+    void Finish() { loader.Finish(); }
+
+    // Starts reloading whatever resident asset is built from file, a canonical path as FileWatcher reports it:
+    // the model of a model file or of a material library next to it, or the texture of an image. Importing and
+    // decoding run on the pool; SwapReloaded() puts the results in place. Files no resident asset uses are ignored.
+    // GL thread only.
+    void Reload(const string &file)
+    {
+        string directory = file.substr(0, file.find_last_of('/'));
+        bool materials = file.size() > 4 && file.compare(file.size() - 4, 4, ".mtl") == 0;
+        for (const auto &entry : models)
+        {
+            ModelHandle model = entry.second.lock();
+            if (!model)
+                continue;
+            if (entry.first == file || (materials && model->directory == directory))
+            {
+                // the mesh cache doesn't know about the material library, its copy of the materials is stale now
+                if (materials)
+                    remove(MeshCache::cachePathFor(entry.first).c_str());
+                reloadModel(entry.first);
+            }
+        }
+
+        auto texture = textures.find(file);
+        if (texture == textures.end())
+            return;
+        if (TextureHandle slot = texture->second.lock())
+        {
+            TextureRole role = slot->role;
+            TextureReload reload;
+            reload.slot = slot;
+            reload.image = pool.submit([file, role] { return DecodeImage(file, role); });
+            textureReloads.push_back(std::move(reload));
+        }
+    }
+
+    // GL thread, between frames: swaps the reloads that have finished into the live models and textures. Only what
+    // changed is uploaded again; a reload that failed leaves the resident version in place.
+    void SwapReloaded()
+    {
+        for (auto it = modelReloads.begin(); it != modelReloads.end();)
+        {
+            if (!finished(it->second))
+            {
+                ++it;
+                continue;
+            }
+            ModelData data = it->second.get();
+            auto found = models.find(it->first);
+            ModelHandle model = found != models.end() ? found->second.lock() : nullptr;
+            if (model && data.meshes.empty())
+                cout << "RELOAD:: " << it->first << " failed to import, keeping the resident model" << endl;
+            else if (model)
+            {
+                model->Reload(std::move(data), *this);
+                cout << "RELOAD:: swapped in " << it->first << endl;
+            }
+            it = modelReloads.erase(it);
+        }
+
+        vector<TextureReload> pendingTextures;
+        for (TextureReload &reload : textureReloads)
+        {
+            if (!finished(reload.image))
+            {
+                pendingTextures.push_back(std::move(reload));
+                continue;
+            }
+            ImageData image = reload.image.get();
+            TextureHandle slot = reload.slot.lock();
+            if (!slot)
+                continue;
+            if (!image.pixels)
+                cout << "RELOAD:: a texture failed to decode, keeping the resident one" << endl;
+            else if (streamer)
+                streamer->Enqueue(slot, image, slot->role == TextureRole::Colour); // the old texture stays bound until the new one is resident
+            else
+                slot->Adopt(TextureFromImage(image, slot->role == TextureRole::Colour));
+        }
+        textureReloads.swap(pendingTextures);
+    }
+
+    // GL thread: frees the GL objects of assets that are no longer referenced
+    void CollectGarbage()
+    {
+        vector<Model *> deadModels;
+        vector<TextureHandle> deadTextures;
+        // releasing a model drops its texture handles, which may bury more textures
+        forgetExpired();
+        while (graveyard->Take(deadModels, deadTextures))
+        {
+            for (Model *model : deadModels)
+                delete model;
+            deadModels.clear();
+            // a slot deletes its texture with the last handle, here unless the loader or streamer still holds it
+            deadTextures.clear();
+            forgetExpired();
+        }
+    }
+
+    AssetStats Stats() const
+    {
+        AssetStats result = stats;
+        result.residentModels = 0;
+        result.residentTextures = 0;
+        for (const auto &entry : models)
+        {
+            if (ModelHandle model = entry.second.lock())
+            {
+                ModelVertexStats vertices = model->VertexStats();
+                result.residentModels++;
+                result.vertexBytes += vertices.vertexBytes;
+                result.fullVertexBytes += vertices.fullVertexBytes;
+                result.deferredTextures += model->DeferredTextures();
+            }
+        }
+        for (const auto &texture : textures)
+            result.residentTextures += !texture.second.expired();
+        return result;
+    }
+
+    // absolute path with symlinks and "." / ".." resolved, so different spellings of a path share one entry
+    static string CanonicalPath(const string &path)
+    {
+        char resolved[PATH_MAX];
+        if (realpath(path.c_str(), resolved))
+            return string(resolved);
+        return path;
+    }
+
+private:
+    // assets whose last handle is gone; filled from whichever thread drops the handle, emptied on the GL thread
+    class Graveyard
+    {
+    public:
+        void Bury(Model *model)
+        {
+            lock_guard<mutex> lock(guard);
+            models.push_back(model);
+        }
+        void Bury(const TextureHandle &texture)
+        {
+            lock_guard<mutex> lock(guard);
+            textures.push_back(texture);
+        }
+        // moves everything buried so far out; false if there was nothing new
+        bool Take(vector<Model *> &deadModels, vector<TextureHandle> &deadTextures)
+        {
+            lock_guard<mutex> lock(guard);
+            if (models.empty() && textures.empty())
+                return false;
+            deadModels.swap(models);
+            deadTextures.swap(textures);
+            return true;
+        }
+
+    private:
+        mutex guard;
+        vector<Model *> models;
+        vector<TextureHandle> textures;
+    };
+
+    // a texture whose file changed, being decoded again
+    struct TextureReload {
+        weak_ptr<TextureSlot> slot;
+        future<ImageData> image;
+    };
+
+    template <typename T>
+    static bool finished(const future<T> &result)
+    {
+        return result.wait_for(chrono::seconds(0)) == future_status::ready;
+    }
+
+    // imports the model at key again on the pool
+    void reloadModel(const string &key)
+    {
+        // a reload still running for the same model is simply superseded, its result is dropped
+        modelReloads[key] = Model::ImportAsync(key, pool);
+    }
+
+    // drops the entries of released assets; this also destroys the deleters that keep buried texture slots alive
+    void forgetExpired()
+    {
+        for (auto it = models.begin(); it != models.end();)
+            it = it->second.expired() ? models.erase(it) : next(it);
+        for (auto it = textures.begin(); it != textures.end();)
+            it = it->second.expired() ? textures.erase(it) : next(it);
+    }
+
+    ThreadPool &pool;
+    TextureUploadQueue *streamer;
+    TextureLoader loader;
+    shared_ptr<Graveyard> graveyard;
+    map<string, weak_ptr<Model>> models;
+    map<string, weak_ptr<TextureSlot>> textures;
+    map<string, future<ModelData>> importing;
+    map<string, future<ModelData>> modelReloads;
+    vector<TextureReload> textureReloads;
+    AssetStats stats;
+};
+#endif
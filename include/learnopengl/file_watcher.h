@@ -0,0 +1,165 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <sys/inotify.h>
+#include <dirent.h>
+#include <limits.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Watches a directory tree for files that have been written, on a thread of its own, through inotify. A file
+// counts as written when a writer closes it or when it is renamed into place (as WriteFileAtomic and most
+// editors save). Changed() reports a file once its writes have settled, i.e. nothing has touched it for
+// settleMilliseconds, so a save in several steps is reported once. Directories created later are watched too.
+class FileWatcher
+{
+public:
+    explicit FileWatcher(const string &root, int settleMilliseconds = 150) : settle(settleMilliseconds)
+    {
+        inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify < 0 || pipe(wakeup) != 0)
+        {
+            cout << "WATCHER:: can't watch " << root << ", edits won't be picked up" << endl;
+            return;
+        }
+        addTree(root);
+        cout << "WATCHER:: watching " << directories.size() << " directories under " << root << endl;
+        worker = thread([this] { run(); });
+    }
+
+    ~FileWatcher()
+    {
+        if (worker.joinable())
+        {
+            char stop = 0;
+            if (write(wakeup[1], &stop, 1) == 1)
+                worker.join();
+            else
+                worker.detach();
+        }
+        if (wakeup[0] >= 0)
+        {
+            close(wakeup[0]);
+            close(wakeup[1]);
+        }
+        if (inotify >= 0)
+            close(inotify);
+    }
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    // canonical absolute paths of the files written since the last call whose writes have settled. Any thread.
+    vector<string> Changed()
+    {
+        vector<string> settled;
+        auto now = chrono::steady_clock::now();
+        lock_guard<mutex> lock(guard);
+        for (auto it = pending.begin(); it != pending.end();)
+        {
+            if (now - it->second < chrono::milliseconds(settle))
+            {
+                ++it;
+                continue;
+            }
+            // a temporary file renamed into place since is reported under its final name
+            if (access(it->first.c_str(), F_OK) == 0)
+                settled.push_back(it->first);
+            it = pending.erase(it);
+        }
+        return settled;
+    }
+
+    bool Watching() const { return worker.joinable(); }
+
+private:
+    int settle;
+    int inotify = -1;
+    int wakeup[2] = { -1, -1 }; // written to by the destructor to stop the thread
+    thread worker;
+    mutex guard;
+    map<int, string> directories;                          // by watch descriptor; only touched by the thread after construction
+    map<string, chrono::steady_clock::time_point> pending; // written files by the time of their last event
+
+    // watches directory and everything below it
+    void addTree(const string &directory)
+    {
+        char resolved[PATH_MAX];
+        if (!realpath(directory.c_str(), resolved))
+            return;
+        int watch = inotify_add_watch(inotify, resolved, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR);
+        if (watch < 0 || directories.count(watch))
+            return;
+        directories[watch] = resolved;
+
+        DIR *dir = opendir(resolved);
+        if (!dir)
+            return;
+        vector<string> children;
+        while (dirent *entry = readdir(dir))
+        {
+            string name = entry->d_name;
+            if (entry->d_type == DT_DIR && name != "." && name != "..")
+                children.push_back(string(resolved) + '/' + name);
+        }
+        closedir(dir);
+        for (const string &child : children)
+            addTree(child);
+    }
+
+    void run()
+    {
+        // large enough for a burst of events; each one is followed by its name
+        alignas(inotify_event) char buffer[64 * 1024];
+        pollfd sources[2] = { { inotify, POLLIN, 0 }, { wakeup[0], POLLIN, 0 } };
+        while (poll(sources, 2, -1) >= 0 || errno == EINTR)
+        {
+            if (sources[1].revents)
+                return;
+            ssize_t length;
+            while ((length = read(inotify, buffer, sizeof(buffer))) > 0)
+            {
+                for (char *p = buffer; p < buffer + length;)
+                {
+                    const inotify_event *event = (const inotify_event *)p;
+                    p += sizeof(inotify_event) + event->len;
+                    auto directory = directories.find(event->wd);
+                    if (directory == directories.end())
+                        continue;
+                    if (event->mask & IN_IGNORED)
+                    {
+                        directories.erase(directory);
+                        continue;
+                    }
+                    if (event->len == 0)
+                        continue;
+                    string path = directory->second + '/' + event->name;
+                    if (event->mask & IN_ISDIR)
+                    {
+                        if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                            addTree(path);
+                        continue;
+                    }
+                    // a created file is reported once it has been written and closed
+                    if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                    {
+                        lock_guard<mutex> lock(guard);
+                        pending[path] = chrono::steady_clock::now();
+                    }
+                }
+            }
+        }
+    }
+};
+#endif
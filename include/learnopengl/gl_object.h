@@ -0,0 +1,141 @@
+#ifndef GL_OBJECT_H
+#define GL_OBJECT_H
+
+#include <glad/glad.h>
+
+// how each kind of GL object is created and deleted
+struct GLBufferTraits {
+    static unsigned int Create()
+    {
+        unsigned int id;
+        glGenBuffers(1, &id);
+        return id;
+    }
+    static void Delete(unsigned int id) { glDeleteBuffers(1, &id); }
+};
+
+struct GLVertexArrayTraits {
+    static unsigned int Create()
+    {
+        unsigned int id;
+        glGenVertexArrays(1, &id);
+        return id;
+    }
+    static void Delete(unsigned int id) { glDeleteVertexArrays(1, &id); }
+};
+
+struct GLTextureTraits {
+    static unsigned int Create()
+    {
+        unsigned int id;
+        glGenTextures(1, &id);
+        return id;
+    }
+    static void Delete(unsigned int id) { glDeleteTextures(1, &id); }
+};
+
+struct GLProgramTraits {
+    static unsigned int Create() { return glCreateProgram(); }
+    static void Delete(unsigned int id) { glDeleteProgram(id); }
+};
+
+// Owns one GL object and deletes it when it goes away. Move-only, so whatever holds one (a mesh's buffers, a
+// model, a shader) can be moved around but never copied into a second owner. Converts to the object's name, so
+// it can be handed to GL calls as it is. Like any GL call, deleting has to happen on the GL thread while the
+// context is still alive.
+template <typename Traits>
+class GLObject
+{
+public:
+    GLObject() = default;
+    // takes ownership of an existing object
+    explicit GLObject(unsigned int id) : id(id) {}
+    ~GLObject() { Reset(); }
+
+    GLObject(const GLObject &) = delete;
+    GLObject &operator=(const GLObject &) = delete;
+
+    GLObject(GLObject &&other) noexcept : id(other.id) { other.id = 0; }
+    GLObject &operator=(GLObject &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+
+    // a new, empty object of the kind
+    static GLObject Create() { return GLObject(Traits::Create()); }
+
+    // deletes the object now instead of when the handle goes away
+    void Reset()
+    {
+        if (id)
+            Traits::Delete(id);
+        id = 0;
+    }
+
+    operator unsigned int() const { return id; }
+
+private:
+    unsigned int id = 0;
+};
+
+typedef GLObject<GLBufferTraits> GLBuffer;
+typedef GLObject<GLVertexArrayTraits> GLVertexArray;
+typedef GLObject<GLTextureTraits> GLTexture;
+typedef GLObject<GLProgramTraits> GLProgram;
+
+// Owns a fence sync object like GLObject owns a name; GLsync is a pointer, so it gets a class of its own.
+class GLFence
+{
+public:
+    GLFence() = default;
+    ~GLFence() { Reset(); }
+
+    GLFence(const GLFence &) = delete;
+    GLFence &operator=(const GLFence &) = delete;
+
+    GLFence(GLFence &&other) noexcept : sync(other.sync) { other.sync = 0; }
+    GLFence &operator=(GLFence &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            sync = other.sync;
+            other.sync = 0;
+        }
+        return *this;
+    }
+
+    // a fence behind every GL command issued so far
+    static GLFence Insert()
+    {
+        GLFence fence;
+        fence.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        return fence;
+    }
+
+    // whether the commands before the fence have completed, waiting up to timeout nanoseconds for them
+    bool Signaled(GLuint64 timeout = 0) const
+    {
+        GLenum status = glClientWaitSync(sync, timeout ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+        return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    }
+
+    void Reset()
+    {
+        if (sync)
+            glDeleteSync(sync);
+        sync = 0;
+    }
+
+    explicit operator bool() const { return sync != 0; }
+
+private:
+    GLsync sync = 0;
+};
+#endif
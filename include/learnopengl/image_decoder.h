@@ -0,0 +1,179 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <stb_image.h>
+#ifdef HAVE_LIBJPEG_TURBO
+#include <cstdio>
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+#include <learnopengl/startup_trace.h>
+#include <learnopengl/texture_cache.h>
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+using namespace std;
+
+// Turns a compressed image in memory into 8 bit texels, one to four components per texel as the image has them.
+// Decoders don't use OpenGL and may run on several threads at once.
+class ImageDecoder
+{
+public:
+    virtual ~ImageDecoder() {}
+    virtual const char *Name() const = 0;
+    // whether data is in a format this decoder reads, judged by its first bytes
+    virtual bool Accepts(const unsigned char *data, size_t size) const = 0;
+    // an image without pixels if data can't be decoded
+    virtual ImageData Decode(const unsigned char *data, size_t size) const = 0;
+};
+
+// stb_image: every format the game uses. Its JPEG IDCT and colour conversion use SSE2 on x86-64 and NEON on ARM
+// (libs/stb_image.cpp turns that on).
+class StbImageDecoder : public ImageDecoder
+{
+public:
+    const char *Name() const override
+    {
+#if defined(__SSE2__) || defined(_M_X64)
+        return "stb_image (SSE2)";
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        return "stb_image (NEON)";
+#else
+        return "stb_image";
+#endif
+    }
+
+    bool Accepts(const unsigned char *data, size_t size) const override { return true; }
+
+    ImageData Decode(const unsigned char *data, size_t size) const override
+    {
+        ImageData image;
+        if (size > INT_MAX)
+            return image;
+        unsigned char *pixels = stbi_load_from_memory(data, (int)size, &image.width, &image.height, &image.nrComponents, 0);
+        if (pixels)
+            image.pixels = shared_ptr<unsigned char>(pixels, stbi_image_free);
+        return image;
+    }
+};
+
+#ifdef HAVE_LIBJPEG_TURBO
+// libjpeg-turbo, found by CMake: JPEGs only, several times faster than stb_image. Grey images keep one component,
+// the rest are converted to RGB; CMYK images are left to stb_image.
+class JpegTurboDecoder : public ImageDecoder
+{
+public:
+    const char *Name() const override { return "libjpeg-turbo"; }
+
+    bool Accepts(const unsigned char *data, size_t size) const override
+    {
+        return size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+    }
+
+    ImageData Decode(const unsigned char *data, size_t size) const override
+    {
+        ImageData image;
+        unsigned char *pixels = decode(data, size, image.width, image.height, image.nrComponents);
+        if (pixels)
+            image.pixels = shared_ptr<unsigned char>(pixels, free);
+        return image;
+    }
+
+private:
+    struct ErrorManager {
+        jpeg_error_mgr manager;
+        jmp_buf jump;
+    };
+
+    // libjpeg reports errors by calling error_exit, which mustn't return
+    static void errorExit(j_common_ptr info) { longjmp(((ErrorManager *)info->err)->jump, 1); }
+    static void ignoreMessage(j_common_ptr info) {}
+
+    // libjpeg errors jump back into this function, so nothing in it may have a destructor
+    static unsigned char *decode(const unsigned char *data, size_t size, int &width, int &height, int &components)
+    {
+        jpeg_decompress_struct info;
+        memset(&info, 0, sizeof(info));
+        ErrorManager error;
+        info.err = jpeg_std_error(&error.manager);
+        error.manager.error_exit = errorExit;
+        error.manager.output_message = ignoreMessage; // corrupt data warnings; stb_image wouldn't mention them either
+        unsigned char *volatile pixels = nullptr;
+        if (setjmp(error.jump))
+        {
+            jpeg_destroy_decompress(&info);
+            free(pixels);
+            return nullptr;
+        }
+
+        jpeg_create_decompress(&info);
+        jpeg_mem_src(&info, data, (unsigned long)size);
+        jpeg_read_header(&info, TRUE);
+        if (info.jpeg_color_space == JCS_CMYK || info.jpeg_color_space == JCS_YCCK)
+        {
+            jpeg_destroy_decompress(&info);
+            return nullptr;
+        }
+        info.out_color_space = info.jpeg_color_space == JCS_GRAYSCALE ? JCS_GRAYSCALE : JCS_RGB;
+        jpeg_start_decompress(&info);
+
+        size_t stride = (size_t)info.output_width * info.output_components;
+        pixels = (unsigned char *)malloc(stride * info.output_height);
+        if (!pixels)
+        {
+            jpeg_destroy_decompress(&info);
+            return nullptr;
+        }
+        while (info.output_scanline < info.output_height)
+        {
+            // straight into the image, a batch of rows per call
+            JSAMPROW rows[16];
+            JDIMENSION count = min((JDIMENSION)16, info.output_height - info.output_scanline);
+            for (JDIMENSION i = 0; i < count; i++)
+                rows[i] = pixels + stride * (info.output_scanline + i);
+            jpeg_read_scanlines(&info, rows, count);
+        }
+        jpeg_finish_decompress(&info);
+
+        width = (int)info.output_width;
+        height = (int)info.output_height;
+        components = info.output_components;
+        jpeg_destroy_decompress(&info);
+        return pixels;
+    }
+};
+#endif
+
+// the decoders images are tried with, most specialised first; the first one that accepts an image and decodes it
+// wins, stb_image is last and takes everything
+inline const vector<const ImageDecoder *> &ImageDecoders()
+{
+    static StbImageDecoder stb;
+#ifdef HAVE_LIBJPEG_TURBO
+    static JpegTurboDecoder jpeg;
+    static const vector<const ImageDecoder *> decoders = { &jpeg, &stb };
+#else
+    static const vector<const ImageDecoder *> decoders = { &stb };
+#endif
+    return decoders;
+}
+
+// decodes a compressed image in memory with the first decoder that can; no pixels if none can
+inline ImageData DecodeImageMemory(const unsigned char *data, size_t size)
+{
+    for (const ImageDecoder *decoder : ImageDecoders())
+    {
+        if (!decoder->Accepts(data, size))
+            continue;
+        TraceScope scope(decoder->Name());
+        ImageData image = decoder->Decode(data, size);
+        if (image.pixels)
+            return image;
+    }
+    return ImageData();
+}
+#endif
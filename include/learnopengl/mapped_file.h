@@ -0,0 +1,126 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Read-only memory mapping of a whole file, unmapped on destruction.
+class MappedFile
+{
+public:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+
+    explicit MappedFile(const string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED)
+            {
+                data = (const unsigned char *)ptr;
+                size = (size_t)st.st_size;
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile()
+    {
+        if (data)
+            munmap((void *)data, size);
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool valid() const { return data != nullptr; }
+};
+
+// 64-bit FNV-1a, used for source contents and cache payload checksums.
+inline uint64_t Fnv1a(const unsigned char *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t HashFile(const string &path)
+{
+    MappedFile file(path);
+    return file.valid() ? Fnv1a(file.data, file.size) : 0;
+}
+
+// writes the concatenation of parts to path through a temporary file and a rename, so readers never see a
+// half written file. The temporary name is unique per writer since two threads may write the same path at once.
+inline bool WriteFileAtomic(const string &path, const vector<pair<const void *, size_t>> &parts)
+{
+    string tmpPath = path + ".tmp" + to_string(getpid()) + "_" + to_string(hash<thread::id>()(this_thread::get_id()));
+    {
+        ofstream out(tmpPath, ios::binary | ios::trunc);
+        if (!out)
+            return false;
+        for (const auto &part : parts)
+            out.write((const char *)part.first, part.second);
+        if (!out)
+        {
+            out.close();
+            remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    return rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+// Identity of a source file as recorded in the caches built from it: size, mtime and content hash.
+struct SourceStamp {
+    uint64_t size = 0;
+    uint64_t mtime = 0;
+    uint64_t contentHash = 0;
+
+    // stamp of the file at path; false if it doesn't exist
+    static bool Of(const string &path, SourceStamp &stamp)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return false;
+        stamp.size = (uint64_t)st.st_size;
+        stamp.mtime = mtimeOf(st);
+        stamp.contentHash = HashFile(path);
+        return true;
+    }
+
+    // whether the file at path is still the one this stamp was taken from. A different mtime alone (e.g. after
+    // a fresh checkout) doesn't count as a change if the contents hash the same.
+    bool Matches(const string &path) const
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || (uint64_t)st.st_size != size)
+            return false;
+        return mtimeOf(st) == mtime || HashFile(path) == contentHash;
+    }
+
+private:
+    static uint64_t mtimeOf(const struct stat &st)
+    {
+        return (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+    }
+};
+#endif
@@ -0,0 +1,19 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <unistd.h>
+
+#include <cstdio>
+
+// physical memory the process currently occupies (its resident set), from /proc; 0 where that isn't available
+inline size_t ResidentMemoryBytes()
+{
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm)
+        return 0;
+    unsigned long pages = 0, resident = 0;
+    int read = fscanf(statm, "%lu %lu", &pages, &resident);
+    fclose(statm);
+    return read == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+}
+#endif
@@ -6,8 +6,15 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/gl_object.h>
+#include <learnopengl/meshlet.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/vertex_format.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 using namespace std;
@@ -26,11 +33,192 @@ struct Vertex {
 };
 
 
+// converts vertices to the compact format, quantizing positions to the bounds of the mesh
+inline vector<PackedVertex> PackVertices(const vector<Vertex> &vertices, VertexQuantization &quantization)
+{
+    glm::vec3 lower(0.0f), upper(0.0f);
+    if (!vertices.empty())
+        lower = upper = vertices[0].Position;
+    for (const Vertex &vertex : vertices)
+    {
+        lower = glm::min(lower, vertex.Position);
+        upper = glm::max(upper, vertex.Position);
+    }
+    quantization.offset = lower;
+    // unorm16 maps 65535 to 1.0, so the quantized range spans exactly the bounds; a flat axis still needs a scale
+    quantization.scale = glm::max(upper - lower, glm::vec3(1e-20f));
+
+    vector<PackedVertex> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const Vertex &vertex = vertices[i];
+        PackedVertex &out = packed[i];
+        glm::vec3 unit = (vertex.Position - quantization.offset) / quantization.scale;
+        for (int axis = 0; axis < 3; axis++)
+            out.Position[axis] = (uint16_t)lround(max(0.0f, min(1.0f, unit[axis])) * 65535.0f);
+
+        glm::vec3 normal = vertex.Normal, tangent = vertex.Tangent;
+        // handedness of the tangent frame, so the bitangent can be rebuilt from the normal and tangent
+        out.Position[3] = glm::dot(glm::cross(normal, tangent), vertex.Bitangent) < 0.0f ? 0 : 65535;
+        OctEncode(glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f, 0.0f, 1.0f), out.Normal);
+        OctEncode(glm::length(tangent) > 0.0f ? glm::normalize(tangent) : glm::vec3(1.0f, 0.0f, 0.0f), out.Tangent);
+        out.TexCoords[0] = FloatToHalf(vertex.TexCoords.x);
+        out.TexCoords[1] = FloatToHalf(vertex.TexCoords.y);
+    }
+    return packed;
+}
+
+// One vertex buffer and one index buffer shared by the meshes of a model, behind a single vertex array. Meshes
+// append their data while the pool is staging, Upload creates the GL objects, and every mesh then draws its part
+// through a base vertex and an index offset, so drawing a whole model binds one vertex array.
+class MeshBufferPool
+{
+public:
+    GLVertexArray VAO;
+
+    explicit MeshBufferPool(VertexFormat format) : format(format) {}
+
+    VertexFormat Format() const { return format; }
+
+    // bytes per vertex in the vertex buffer
+    size_t VertexStride() const
+    {
+        return format == VertexFormat::Compact ? sizeof(PackedVertex) : sizeof(Vertex);
+    }
+
+    // makes room for the data about to be appended, so staging a whole model allocates once instead of growing
+    void Reserve(size_t vertexCount, size_t indexBytes)
+    {
+        vertexData.reserve(vertexData.size() + vertexCount * VertexStride());
+        indexData.reserve(indexData.size() + indexBytes);
+    }
+
+    // stages count vertices in the pool's format; returns the index of the first one
+    int AppendVertices(const void *data, size_t count)
+    {
+        int first = (int)(vertexData.size() / VertexStride());
+        vertexData.insert(vertexData.end(), (const unsigned char *)data, (const unsigned char *)data + count * VertexStride());
+        return first;
+    }
+
+    // stages index data and returns its byte offset; offsets are 4 byte aligned so 16 and 32 bit meshes can share
+    // the buffer
+    size_t AppendIndices(const void *data, size_t bytes)
+    {
+        indexData.resize((indexData.size() + 3) & ~(size_t)3);
+        size_t offset = indexData.size();
+        indexData.insert(indexData.end(), (const unsigned char *)data, (const unsigned char *)data + bytes);
+        return offset;
+    }
+
+    // creates the buffers and the vertex array from everything appended so far and drops the staged copies.
+    // Must be called on the GL thread.
+    void Upload()
+    {
+        VAO = GLVertexArray::Create();
+        VBO = GLBuffer::Create();
+        EBO = GLBuffer::Create();
+
+        glBindVertexArray(VAO);
+        // load data into vertex buffers
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size(), indexData.data(), GL_STATIC_DRAW);
+
+        // set the vertex attribute pointers
+        if (format == VertexFormat::Compact)
+            setupCompactAttributes();
+        else
+            setupFullAttributes();
+        glBindVertexArray(0);
+
+        vertexBytes = vertexData.size();
+        indexBytes = indexData.size();
+        vector<unsigned char>().swap(vertexData);
+        vector<unsigned char>().swap(indexData);
+    }
+
+    size_t VertexBytes() const { return vertexBytes; }
+    size_t IndexBytes() const { return indexBytes; }
+
+    // deletes the vertex array and buffers before the pool goes away; nothing in it can be drawn afterwards
+    void Release()
+    {
+        VAO.Reset();
+        VBO.Reset();
+        EBO.Reset();
+    }
+
+private:
+    VertexFormat format;
+    GLBuffer VBO, EBO;
+    vector<unsigned char> vertexData, indexData; // staged until Upload
+    size_t vertexBytes = 0, indexBytes = 0;
+
+    // attribute pointers of Vertex
+    void setupFullAttributes()
+    {
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        // vertex tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        // vertex bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+    }
+
+    // attribute pointers of PackedVertex; the bitangent (location 4) isn't stored, shaders rebuild it
+    void setupCompactAttributes()
+    {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+        glDisableVertexAttribArray(4);
+    }
+};
+
+// a simplified version of a mesh: its own triangles over the vertices of the full mesh
+struct MeshLod {
+    vector<unsigned int> indices;
+    float error = 0.0f; // how far, in model units, the surface may have moved from the full mesh
+};
+
+// what a cluster culled draw of a mesh submitted
+struct ClusterDrawStats {
+    unsigned int clustersDrawn = 0;
+    unsigned int clustersTotal = 0;
+    size_t trianglesDrawn = 0;
+};
+
+// what a mesh keeps in memory once its vertices and indices are in the GPU buffers
+enum class CpuRetention {
+    Release,   // nothing: the mesh can only be drawn
+    Positions, // the full level's indices and the vertex positions, for picking and collision
+    Full,      // every vertex and every level's indices, for editing
+};
 
 struct Texture {
-    unsigned int id;
+    TextureHandle handle; // resolves to the GL texture once it has been uploaded
     string type;
     string path;
+    // set while a lazily loaded texture hasn't been requested yet: the first draw of the mesh requests file from
+    // source, which has to outlive the mesh, and handle is a placeholder until then
+    TextureSource *source = nullptr;
+    string file;
 };
 
 class Mesh {
@@ -39,22 +227,206 @@ public:
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    vector<MeshLod>      lods; // coarser and coarser, level i + 1 draws lods[i]; their indices are gone after ReleaseCpuData
+    vector<glm::vec3>    positions; // only kept by ReleaseCpuData(CpuRetention::Positions), indexed by indices
 
-    unsigned int VAO;
+    shared_ptr<MeshBufferPool> buffers; // holds this mesh's vertices and indices, usually with the rest of its model
+    int firstVertex = 0;                // of the mesh in the pool's vertex buffer
+    size_t indexBufferOffset = 0;       // byte offset of the mesh's indices in the pool's index buffer
     std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    VertexFormat format;
+    VertexQuantization quantization; // only used by the compact format
+    GLenum indexType = GL_UNSIGNED_INT; // GL_UNSIGNED_SHORT whenever the vertex count allows it
+    vector<IndexRange> drawRanges;      // every level's runs, more than one per level if a 16 bit mesh had to be split
+    vector<Meshlet> meshlets;           // clusters of the full level, for DrawClusters
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+    // constructor. Without a pool the mesh gets buffers of its own right away; with one, its data is appended to
+    // the pool and can be drawn once the pool's owner has called Upload.
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, VertexFormat format = VertexFormat::Full,
+         vector<MeshLod> lods = vector<MeshLod>(), shared_ptr<MeshBufferPool> pool = nullptr)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+        this->format = pool ? pool->Format() : format;
+        this->lods = std::move(lods);
+        this->buffers = pool ? pool : make_shared<MeshBufferPool>(format);
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
+        if (!pool)
+            buffers->Upload();
+    }
+
+    // meshes are moved into their model, never copied: a copy would duplicate every vertex and index
+    Mesh(Mesh &&) = default;
+    Mesh &operator=(Mesh &&) = default;
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+
+    // render the mesh, at the given level of detail (0 is the full mesh)
+    void Draw(Shader &shader, int level = 0)
+    {
+        glBindVertexArray(buffers->VAO);
+        DrawBound(shader, level);
+        glBindVertexArray(0);
+    }
+
+    // like Draw, for when the pool's vertex array is already bound: a model binds it once for all its meshes
+    void DrawBound(Shader &shader, int level = 0)
+    {
+        bindMaterial(shader);
+
+        // draw mesh
+        level = max(0, min(level, LodCount() - 1));
+        for (size_t r = levelRanges[level]; r < levelRanges[level + 1]; r++)
+        {
+            const IndexRange &range = drawRanges[r];
+            glDrawElementsBaseVertex(GL_TRIANGLES, range.count, indexType, indexOffset(range.first), firstVertex + range.baseVertex);
+        }
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // renders the full mesh minus the clusters that are outside the frustum, all in a single multi-draw, with the
+    // pool's vertex array bound. With cullBackfacing, clusters that face away from the camera are skipped too, which
+    // is only right when back faces are culled by GL_CULL_FACE as well. frustum and cameraPosition are in world
+    // space, modelMatrix takes the mesh there and may scale, but only uniformly.
+    ClusterDrawStats DrawClusters(Shader &shader, const glm::mat4 &modelMatrix, const Frustum &frustum, const glm::vec3 &cameraPosition,
+                                  bool cullBackfacing)
+    {
+        ClusterDrawStats stats;
+        stats.clustersTotal = (unsigned int)meshlets.size();
+        float scale = max(glm::length(glm::vec3(modelMatrix[0])), max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        glm::mat3 rotation = glm::mat3(modelMatrix); // normals only need the direction, the scale is normalized away
+
+        clusterCounts.clear();
+        clusterOffsets.clear();
+        clusterBaseVertices.clear();
+        for (const Meshlet &meshlet : meshlets)
+        {
+            glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(meshlet.center, 1.0f));
+            float radius = meshlet.radius * scale;
+            if (!frustum.IntersectsSphere(center, radius)
+                || (cullBackfacing && MeshletBackfacing(center, radius, glm::normalize(rotation * meshlet.coneAxis), meshlet.coneCutoff, cameraPosition)))
+                continue;
+            clusterCounts.push_back((GLsizei)meshlet.count);
+            clusterOffsets.push_back(indexOffset(meshlet.first));
+            clusterBaseVertices.push_back(firstVertex + meshlet.baseVertex);
+            stats.trianglesDrawn += meshlet.count / 3;
+        }
+        stats.clustersDrawn = (unsigned int)clusterCounts.size();
+        if (clusterCounts.empty())
+            return stats;
+
+        bindMaterial(shader);
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, clusterCounts.data(), indexType, clusterOffsets.data(),
+                                      (GLsizei)clusterCounts.size(), clusterBaseVertices.data());
+        glActiveTexture(GL_TEXTURE0);
+        return stats;
+    }
+
+    // levels of detail including the full mesh
+    int LodCount() const
+    {
+        return 1 + (int)lods.size();
+    }
+
+    const vector<unsigned int> &LodIndices(int level) const
+    {
+        return level == 0 ? indices : lods[level - 1].indices;
+    }
+
+    // indices a level draws, also once the CPU copies are gone
+    size_t LodIndexCount(int level) const
+    {
+        size_t count = 0;
+        for (size_t r = levelRanges[level]; r < levelRanges[level + 1]; r++)
+            count += drawRanges[r].count;
+        return count;
+    }
+
+    // the coarsest level whose error, seen at pixelsPerUnit, stays within maxErrorPixels
+    int SelectLod(float pixelsPerUnit, float maxErrorPixels) const
+    {
+        for (int level = (int)lods.size(); level > 0; level--)
+        {
+            if (lods[level - 1].error * pixelsPerUnit <= maxErrorPixels)
+                return level;
+        }
+        return 0;
+    }
+
+    // bytes per vertex in the vertex buffer
+    size_t VertexStride() const
+    {
+        return buffers->VertexStride();
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // indices in the index buffer, of all levels
+    size_t IndexCount() const
+    {
+        size_t count = 0;
+        for (int level = 0; level < LodCount(); level++)
+            count += LodIndexCount(level);
+        return count;
+    }
+
+    // bytes of the mesh's indices in the index buffer
+    size_t IndexBytes() const
+    {
+        return IndexCount() * (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int));
+    }
+
+    // Frees the CPU copies of the geometry that retention doesn't ask for; call once the pool has been uploaded.
+    // Drawing, level selection and cluster culling keep working. Returns the bytes freed.
+    size_t ReleaseCpuData(CpuRetention retention)
+    {
+        if (retention == CpuRetention::Full)
+            return 0;
+        size_t before = cpuBytes();
+        if (retention == CpuRetention::Positions)
+        {
+            positions.resize(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++)
+                positions[i] = vertices[i].Position;
+        }
+        else
+            vector<unsigned int>().swap(indices);
+        vector<Vertex>().swap(vertices);
+        for (MeshLod &lod : lods)
+            vector<unsigned int>().swap(lod.indices);
+        return before - cpuBytes();
+    }
+
+    // deletes the vertex array and buffers, along with those of every mesh sharing the pool; the mesh can't be
+    // drawn afterwards
+    void Release()
+    {
+        if (buffers)
+            buffers->Release();
+        buffers.reset();
+    }
+
+private:
+    vector<size_t> levelRanges; // level l draws drawRanges[levelRanges[l]] up to drawRanges[levelRanges[l + 1]]
+    // DrawClusters' per draw arrays, kept to avoid reallocating them every frame
+    vector<GLsizei> clusterCounts;
+    vector<const void*> clusterOffsets;
+    vector<GLint> clusterBaseVertices;
+
+    size_t cpuBytes() const
+    {
+        size_t bytes = vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int) + positions.capacity() * sizeof(glm::vec3);
+        for (const MeshLod &lod : lods)
+            bytes += lod.indices.capacity() * sizeof(unsigned int);
+        return bytes;
+    }
+
+    // binds the textures and tells the shader how to decode the vertices
+    void bindMaterial(Shader &shader)
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -63,6 +435,12 @@ public:
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
+            if (textures[i].source)
+            {
+                // the mesh is visible for the first time, the placeholder stays bound until the texture is uploaded
+                textures[i].handle = textures[i].source->Request(textures[i].file, TextureRoleFor(textures[i].type));
+                textures[i].source = nullptr;
+            }
             glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
@@ -79,61 +457,99 @@ public:
             // now set the sampler to the correct texture unit
             glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
             // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            BindTexture(textures[i].handle);
         }
 
-
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        // how the vertex shader has to decode the vertices
+        shader.setBool("quantized", format == VertexFormat::Compact);
+        if (format == VertexFormat::Compact)
+        {
+            shader.setVec3("positionOffset", quantization.offset);
+            shader.setVec3("positionScale", quantization.scale);
+        }
     }
 
-private:
-    // render data
-    unsigned int VBO, EBO;
+    // byte offset of one of the mesh's indices in the pool's index buffer, as the draw calls take it
+    const void *indexOffset(unsigned int first) const
+    {
+        return (const void*)(indexBufferOffset + first * (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int)));
+    }
 
-    // initializes all the buffer objects/arrays
+    // converts the vertices and indices of every level and appends them to the pool
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        // bounding sphere around the box, for picking a level of detail
+        glm::vec3 lower(0.0f), upper(0.0f);
+        if (!vertices.empty())
+            lower = upper = vertices[0].Position;
+        for (const Vertex &vertex : vertices)
+        {
+            lower = glm::min(lower, vertex.Position);
+            upper = glm::max(upper, vertex.Position);
+        }
+        boundsCenter = (lower + upper) * 0.5f;
+        boundsRadius = glm::length(upper - lower) * 0.5f;
 
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        if (format == VertexFormat::Compact)
+        {
+            vector<PackedVertex> packed = PackVertices(vertices, quantization);
+            firstVertex = buffers->AppendVertices(packed.data(), packed.size());
+        }
+        else
+        {
+            // A great thing about structs is that their memory layout is sequential for all its items.
+            // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+            // again translates to 3/2 floats which translates to a byte array.
+            firstVertex = buffers->AppendVertices(vertices.data(), vertices.size());
+        }
 
-        glBindVertexArray(0);
+        // every level goes into the index buffer, back to back. 16 bit indices halve it; the draw ranges tell
+        // Draw how to issue them, and all levels fall back to 32 bits if any of them can't be narrowed
+        size_t indexCount = 0;
+        for (int level = 0; level < LodCount(); level++)
+            indexCount += LodIndices(level).size();
+        vector<uint16_t> narrow, levelNarrow;
+        vector<IndexRange> levelDrawRanges;
+        narrow.reserve(indexCount);
+        drawRanges.clear();
+        levelRanges.assign(1, 0);
+        size_t first = 0;
+        for (int level = 0; level < LodCount(); level++)
+        {
+            if (!NarrowIndices(LodIndices(level), levelNarrow, levelDrawRanges))
+                break;
+            for (IndexRange &range : levelDrawRanges)
+                range.first += (unsigned int)first;
+            drawRanges.insert(drawRanges.end(), levelDrawRanges.begin(), levelDrawRanges.end());
+            narrow.insert(narrow.end(), levelNarrow.begin(), levelNarrow.end());
+            levelRanges.push_back(drawRanges.size());
+            first += LodIndices(level).size();
+        }
+        if ((int)levelRanges.size() == LodCount() + 1)
+        {
+            indexType = GL_UNSIGNED_SHORT;
+            indexBufferOffset = buffers->AppendIndices(narrow.data(), narrow.size() * sizeof(uint16_t));
+        }
+        else
+        {
+            indexType = GL_UNSIGNED_INT;
+            vector<unsigned int> wide;
+            wide.reserve(indexCount);
+            drawRanges.clear();
+            levelRanges.assign(1, 0);
+            for (int level = 0; level < LodCount(); level++)
+            {
+                IndexRange range;
+                range.first = (unsigned int)wide.size();
+                range.count = (unsigned int)LodIndices(level).size();
+                wide.insert(wide.end(), LodIndices(level).begin(), LodIndices(level).end());
+                drawRanges.push_back(range);
+                levelRanges.push_back(drawRanges.size());
+            }
+            indexBufferOffset = buffers->AppendIndices(wide.data(), wide.size() * sizeof(unsigned int));
+        }
+        // the full level comes first, so its runs index into indices directly
+        meshlets = BuildMeshlets(vertices, indices, vector<IndexRange>(drawRanges.begin(), drawRanges.begin() + levelRanges[1]));
     }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,308 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/mapped_file.h>
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// CPU side copy of a single imported mesh, exactly what Model needs to build a Mesh without Assimp.
+struct CachedMesh {
+    vector<Vertex>       vertices;
+    vector<unsigned int> indices;
+    vector<Texture>      textures; // only type and path are stored, ids are resolved by the model on load
+    vector<MeshLod>      lods;
+};
+
+// Versioned binary cache of post-processed meshes, stored next to the source model as "<source>.meshcache".
+// The cache is keyed by the source path, its size and mtime, a hash of its contents, the same stamp of every
+// material library an OBJ source names, the Assimp post-process flags, a key of our own mesh processing settings
+// (see Model::settingsKey) and the layout of Vertex. A mismatch in any of those, or a payload that fails its
+// checksum, makes the cache stale and the caller re-imports the model and writes a fresh one.
+class MeshCache
+{
+public:
+    static const uint32_t Version = 4;
+
+    // processing done on top of Assimp's post-process steps, see Model::loadModel
+    enum MeshFlags : uint32_t {
+        Optimized = 1 << 0, // vertex cache, overdraw and fetch order, see OptimizeMesh
+        Lods      = 1 << 1, // simplified levels of detail, see BuildLodChain
+        ObjParsed = 1 << 2, // read by ObjReader rather than Assimp
+    };
+
+    static string cachePathFor(const string &sourcePath)
+    {
+        return sourcePath + ".meshcache";
+    }
+
+    // fills meshes from the cache of sourcePath; returns false if there is no usable cache.
+    static bool load(const string &sourcePath, unsigned int importFlags, uint64_t settingsKey, vector<CachedMesh> &meshes)
+    {
+        AssetBlob file = ReadAsset(cachePathFor(sourcePath));
+        if (!file)
+            return false;
+
+        Reader in(file.data.get(), file.size);
+        Header header;
+        if (!in.read(header) || memcmp(header.magic, magicTag(), sizeof(header.magic)) != 0)
+            return reject(sourcePath, "bad header");
+        if (header.version != Version || header.vertexSize != sizeof(Vertex) || header.importFlags != importFlags
+            || header.settingsKey != settingsKey)
+            return reject(sourcePath, "built with different settings");
+
+        // a packed cache may have been cooked in another checkout and its source doesn't have to be around
+        string cachedSource;
+        if (!in.readString(cachedSource) || (!file.packed && cachedSource != sourcePath))
+            return reject(sourcePath, "source path mismatch");
+
+        // it is trusted as it is only if its source isn't: an edited source makes it as stale as a loose cache
+        if ((!file.packed || access(sourcePath.c_str(), F_OK) == 0) && !header.source.Matches(sourcePath))
+            return reject(sourcePath, "source changed");
+
+        // the material libraries hold the texture references of the meshes, and are checked the same way
+        string directory = sourcePath.substr(0, sourcePath.find_last_of('/'));
+        uint32_t libraryCount;
+        if (!in.read(libraryCount) || !in.fits(libraryCount, MinLibraryBytes))
+            return reject(sourcePath, "truncated");
+        for (uint32_t i = 0; i < libraryCount; i++)
+        {
+            string library;
+            uint32_t existed;
+            SourceStamp stamp;
+            if (!in.readString(library) || !in.read(existed) || !in.read(stamp))
+                return reject(sourcePath, "truncated");
+            string libraryPath = directory + '/' + library;
+            bool exists = access(libraryPath.c_str(), F_OK) == 0;
+            if (file.packed && !exists)
+                continue;
+            if (exists != (existed != 0) || (exists && !stamp.Matches(libraryPath)))
+                return reject(sourcePath, "material library changed");
+        }
+
+        if (header.payloadHash != Fnv1a(in.cursor(), in.remaining()))
+            return reject(sourcePath, "corrupt payload");
+
+        // the counts come from the file: nothing is sized before the bytes it needs are known to be there, so a
+        // damaged header can't make us allocate gigabytes
+        meshes.clear();
+        if (!in.fits(header.meshCount, MinMeshBytes))
+            return reject(sourcePath, "truncated");
+        meshes.resize(header.meshCount);
+        for (CachedMesh &mesh : meshes)
+        {
+            uint32_t vertexCount, indexCount, textureCount;
+            if (!in.read(vertexCount) || !in.read(indexCount) || !in.read(textureCount))
+                return reject(sourcePath, "truncated");
+            if (!in.fits((uint64_t)vertexCount * sizeof(Vertex) + (uint64_t)indexCount * sizeof(unsigned int)
+                             + (uint64_t)textureCount * MinTextureBytes, 1))
+                return reject(sourcePath, "truncated");
+            mesh.vertices.resize(vertexCount);
+            mesh.indices.resize(indexCount);
+            mesh.textures.resize(textureCount);
+            if (!in.readBytes(mesh.vertices.data(), vertexCount * sizeof(Vertex)) ||
+                !in.readBytes(mesh.indices.data(), indexCount * sizeof(unsigned int)))
+                return reject(sourcePath, "truncated");
+            for (Texture &texture : mesh.textures)
+            {
+                if (!in.readString(texture.type) || !in.readString(texture.path))
+                    return reject(sourcePath, "truncated");
+            }
+            uint32_t lodCount;
+            if (!in.read(lodCount) || !in.fits(lodCount, MinLodBytes))
+                return reject(sourcePath, "truncated");
+            mesh.lods.resize(lodCount);
+            for (MeshLod &lod : mesh.lods)
+            {
+                uint32_t lodIndexCount;
+                if (!in.read(lod.error) || !in.read(lodIndexCount) || !in.fits(lodIndexCount, sizeof(unsigned int)))
+                    return reject(sourcePath, "truncated");
+                lod.indices.resize(lodIndexCount);
+                if (!in.readBytes(lod.indices.data(), lodIndexCount * sizeof(unsigned int)))
+                    return reject(sourcePath, "truncated");
+            }
+        }
+        return true;
+    }
+
+    // writes the cache for sourcePath; the file is replaced atomically so a crash never leaves a half written cache.
+    static bool store(const string &sourcePath, unsigned int importFlags, uint64_t settingsKey, const vector<CachedMesh> &meshes)
+    {
+        SourceStamp source;
+        if (!SourceStamp::Of(sourcePath, source))
+            return false;
+
+        string payload;
+        for (const CachedMesh &mesh : meshes)
+        {
+            append(payload, (uint32_t)mesh.vertices.size());
+            append(payload, (uint32_t)mesh.indices.size());
+            append(payload, (uint32_t)mesh.textures.size());
+            payload.append((const char *)mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            payload.append((const char *)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+            for (const Texture &texture : mesh.textures)
+            {
+                appendString(payload, texture.type);
+                appendString(payload, texture.path);
+            }
+            append(payload, (uint32_t)mesh.lods.size());
+            for (const MeshLod &lod : mesh.lods)
+            {
+                append(payload, lod.error);
+                append(payload, (uint32_t)lod.indices.size());
+                payload.append((const char *)lod.indices.data(), lod.indices.size() * sizeof(unsigned int));
+            }
+        }
+
+        Header header;
+        memcpy(header.magic, magicTag(), sizeof(header.magic));
+        header.version = Version;
+        header.vertexSize = sizeof(Vertex);
+        header.importFlags = importFlags;
+        header.settingsKey = settingsKey;
+        header.meshCount = (uint32_t)meshes.size();
+        header.source = source;
+
+        string sourceField;
+        appendString(sourceField, sourcePath);
+        vector<string> libraries = materialLibraries(sourcePath);
+        append(sourceField, (uint32_t)libraries.size());
+        string directory = sourcePath.substr(0, sourcePath.find_last_of('/'));
+        for (const string &library : libraries)
+        {
+            // a library that is missing now is recorded too, so the cache goes stale once it appears
+            SourceStamp stamp;
+            bool exists = SourceStamp::Of(directory + '/' + library, stamp);
+            appendString(sourceField, library);
+            append(sourceField, (uint32_t)exists);
+            append(sourceField, stamp);
+        }
+        header.payloadHash = Fnv1a((const unsigned char *)payload.data(), payload.size());
+
+        return WriteFileAtomic(cachePathFor(sourcePath), {
+            { &header, sizeof(header) },
+            { sourceField.data(), sourceField.size() },
+            { payload.data(), payload.size() } });
+    }
+
+private:
+    static const char *magicTag() { return "LOGLMSH"; }
+
+    // fewest bytes a mesh (its three counts and its LOD count), a texture (two empty strings) and a LOD level
+    // (error and index count) take up in the payload
+    static const size_t MinMeshBytes = 4 * sizeof(uint32_t);
+    static const size_t MinTextureBytes = 2 * sizeof(uint32_t);
+    static const size_t MinLodBytes = sizeof(float) + sizeof(uint32_t);
+    // and a material library (an empty name, whether it existed and its stamp)
+    static const size_t MinLibraryBytes = 2 * sizeof(uint32_t) + sizeof(SourceStamp);
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t vertexSize;
+        uint32_t importFlags;
+        uint32_t meshCount;
+        uint64_t settingsKey;
+        SourceStamp source;
+        uint64_t payloadHash;
+    };
+
+    // bounds checked cursor over the mapped cache file
+    class Reader
+    {
+    public:
+        Reader(const unsigned char *data, size_t size) : ptr(data), end(data + size) {}
+
+        template<typename T>
+        bool read(T &value) { return readBytes(&value, sizeof(T)); }
+
+        bool readBytes(void *dst, size_t size)
+        {
+            if ((size_t)(end - ptr) < size)
+                return false;
+            if (size)
+                memcpy(dst, ptr, size);
+            ptr += size;
+            return true;
+        }
+
+        bool readString(string &value)
+        {
+            uint32_t length;
+            if (!read(length) || (size_t)(end - ptr) < length)
+                return false;
+            value.assign((const char *)ptr, length);
+            ptr += length;
+            return true;
+        }
+
+        // whether count elements of at least elementSize bytes each can still follow
+        bool fits(uint64_t count, size_t elementSize) const { return count <= remaining() / elementSize; }
+
+        const unsigned char *cursor() const { return ptr; }
+        size_t remaining() const { return end - ptr; }
+
+    private:
+        const unsigned char *ptr;
+        const unsigned char *end;
+    };
+
+    // the material libraries an OBJ file names on its mtllib lines, relative to its directory, as ObjReader and
+    // Assimp read them; none for other formats
+    static vector<string> materialLibraries(const string &sourcePath)
+    {
+        vector<string> libraries;
+        size_t dot = sourcePath.find_last_of('.');
+        if (dot == string::npos || (sourcePath.compare(dot, string::npos, ".obj") != 0 && sourcePath.compare(dot, string::npos, ".OBJ") != 0))
+            return libraries;
+        AssetBlob file = ReadAsset(sourcePath);
+        if (!file)
+            return libraries;
+        const char *p = (const char *)file.data.get(), *end = p + file.size;
+        while (p < end)
+        {
+            const char *eol = (const char *)memchr(p, '\n', end - p);
+            if (!eol)
+                eol = end;
+            while (p < eol && (*p == ' ' || *p == '\t'))
+                p++;
+            if (eol - p > 6 && strncmp(p, "mtllib", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+            {
+                const char *name = p + 6, *nameEnd = eol;
+                while (name < nameEnd && isspace((unsigned char)*name))
+                    name++;
+                while (nameEnd > name && isspace((unsigned char)nameEnd[-1]))
+                    nameEnd--;
+                libraries.emplace_back(name, nameEnd);
+            }
+            p = eol + 1;
+        }
+        return libraries;
+    }
+
+    template<typename T>
+    static void append(string &out, const T &value)
+    {
+        out.append((const char *)&value, sizeof(T));
+    }
+
+    static void appendString(string &out, const string &value)
+    {
+        append(out, (uint32_t)value.size());
+        out.append(value);
+    }
+
+    static bool reject(const string &sourcePath, const char *reason)
+    {
+        cout << "MESH_CACHE:: rebuilding cache for " << sourcePath << " (" << reason << ")" << endl;
+        return false;
+    }
+};
+#endif
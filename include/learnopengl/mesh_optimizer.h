@@ -0,0 +1,307 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mesh.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Post-transform vertex cache efficiency of an index buffer.
+// ACMR: transformed vertices per triangle (0.5 is the best a regular grid gets, 3 means no reuse at all).
+// ATVR: transformed vertices per unique vertex (1 is optimal).
+struct VertexCacheStats {
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+// simulates a FIFO post-transform cache of cacheSize entries over indices
+inline VertexCacheStats AnalyzeVertexCache(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = 16)
+{
+    VertexCacheStats stats;
+    // a vertex is in the cache if it was inserted less than cacheSize insertions ago
+    vector<unsigned int> timestamps(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    size_t misses = 0;
+    for (unsigned int index : indices)
+    {
+        if (time - timestamps[index] > cacheSize)
+        {
+            timestamps[index] = time++;
+            misses++;
+        }
+    }
+    if (!indices.empty())
+        stats.acmr = (float)misses / (indices.size() / 3);
+    if (vertexCount)
+        stats.atvr = (float)misses / vertexCount;
+    return stats;
+}
+
+// merges bitwise identical vertices so triangles share them; Assimp emits a separate vertex per face corner for
+// OBJ files, which leaves the cache nothing to reuse.
+inline void WeldVertices(vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+    struct Hash {
+        const vector<Vertex> *vertices;
+        size_t operator()(unsigned int i) const { return (size_t)Fnv1a((const unsigned char *)&(*vertices)[i], sizeof(Vertex)); }
+    };
+    struct Equal {
+        const vector<Vertex> *vertices;
+        bool operator()(unsigned int a, unsigned int b) const { return memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(Vertex)) == 0; }
+    };
+    unordered_map<unsigned int, unsigned int, Hash, Equal> unique(vertices.size(), Hash{ &vertices }, Equal{ &vertices });
+
+    vector<unsigned int> remap(vertices.size());
+    vector<Vertex> welded;
+    welded.reserve(vertices.size());
+    for (unsigned int i = 0; i < vertices.size(); i++)
+    {
+        auto inserted = unique.emplace(i, (unsigned int)welded.size());
+        if (inserted.second)
+            welded.push_back(vertices[i]);
+        remap[i] = inserted.first->second;
+    }
+    for (unsigned int &index : indices)
+        index = remap[index];
+    vertices.swap(welded);
+}
+
+// Reorders triangles for post-transform cache locality with Tipsify (Sander, Nehab, Barczak 2007): it fans around
+// one vertex at a time and moves to the neighbour that will still be in the cache, or to a recently used vertex
+// when it runs into a dead end. Linear in the number of triangles.
+inline void OptimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = 16)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles around each vertex
+    vector<unsigned int> live(vertexCount, 0), offsets(vertexCount + 1, 0);
+    for (unsigned int index : indices)
+        live[index]++;
+    partial_sum(live.begin(), live.end(), offsets.begin() + 1);
+    vector<unsigned int> adjacency(indices.size()), fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+    vector<unsigned int> timestamps(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    vector<char> emitted(triangleCount, 0);
+    vector<unsigned int> deadEnd, candidates, result;
+    result.reserve(indices.size());
+    size_t cursor = 0; // scan position for vertices with triangles left once the dead end stack is empty
+
+    long fanning = indices[0];
+    while (fanning >= 0)
+    {
+        candidates.clear();
+        for (unsigned int a = offsets[fanning]; a < offsets[fanning + 1]; a++)
+        {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = 1;
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                result.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                live[vertex]--;
+                if (time - timestamps[vertex] > cacheSize)
+                    timestamps[vertex] = time++;
+            }
+        }
+
+        // prefer the oldest candidate that is still cached after fanning around it
+        fanning = -1;
+        long bestPriority = -1;
+        for (unsigned int vertex : candidates)
+        {
+            if (live[vertex] == 0)
+                continue;
+            long priority = 0;
+            if (time - timestamps[vertex] + 2 * live[vertex] <= cacheSize)
+                priority = time - timestamps[vertex];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanning = vertex;
+            }
+        }
+        if (fanning >= 0)
+            continue;
+
+        // dead end: go back to a recently emitted vertex, or the next one in input order
+        while (!deadEnd.empty() && fanning < 0)
+        {
+            unsigned int vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[vertex] > 0)
+                fanning = vertex;
+        }
+        while (fanning < 0 && cursor < vertexCount)
+        {
+            if (live[cursor] > 0)
+                fanning = (long)cursor;
+            cursor++;
+        }
+    }
+    indices.swap(result);
+}
+
+// Reorders clusters of a cache optimized index buffer so triangles facing out from the mesh centre are drawn
+// first and occlude the ones behind them (Tipsify, section 4). Clusters start where the simulated cache runs cold
+// and are split further while that keeps their ACMR within threshold times the original, so the cache
+// efficiency bought by OptimizeVertexCache is mostly kept.
+inline void OptimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices, float threshold = 1.05f, unsigned int cacheSize = 16)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    vector<unsigned int> timestamps(vertices.size(), 0);
+    unsigned int time = cacheSize + 1;
+    auto triangleMisses = [&](size_t triangle) {
+        unsigned int misses = 0;
+        for (int corner = 0; corner < 3; corner++)
+        {
+            unsigned int vertex = indices[triangle * 3 + corner];
+            if (time - timestamps[vertex] > cacheSize)
+            {
+                timestamps[vertex] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+
+    // hard boundaries: triangles whose three vertices all miss, the cache would be cold there anyway. The first
+    // triangle always starts a cluster, even when it repeats a vertex and so misses fewer than three times
+    vector<size_t> hard(1, 0);
+    for (size_t t = 0; t < triangleCount; t++)
+        if (triangleMisses(t) == 3 && t > 0)
+            hard.push_back(t);
+    hard.push_back(triangleCount);
+
+    // soft boundaries inside each hard cluster, restarting the cache at every cluster start
+    vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); h++)
+    {
+        size_t begin = hard[h], end = hard[h + 1];
+        time += cacheSize + 1;
+        unsigned int clusterMisses = 0;
+        for (size_t t = begin; t < end; t++)
+            clusterMisses += triangleMisses(t);
+        float clusterAcmr = (float)clusterMisses / (end - begin);
+
+        time += cacheSize + 1;
+        clusters.push_back(begin);
+        size_t start = begin;
+        unsigned int misses = 0;
+        for (size_t t = begin; t < end; t++)
+        {
+            misses += triangleMisses(t);
+            if (t + 1 < end && (float)misses / (t - start + 1) <= clusterAcmr * threshold)
+            {
+                clusters.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                time += cacheSize + 1;
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // sort key: how far the cluster faces away from the mesh centre
+    glm::vec3 meshCentre(0.0f);
+    for (const Vertex &vertex : vertices)
+        meshCentre += vertex.Position;
+    meshCentre /= (float)max((size_t)1, vertices.size());
+
+    size_t clusterCount = clusters.size() - 1;
+    vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+            float faceArea = glm::length(faceNormal);
+            centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+        if (area > 0.0f)
+            centroid /= area;
+        float normalLength = glm::length(normal);
+        sortKey[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentre, normal / normalLength) : 0.0f;
+    }
+
+    vector<unsigned int> order(clusterCount);
+    iota(order.begin(), order.end(), 0u);
+    stable_sort(order.begin(), order.end(), [&sortKey](unsigned int a, unsigned int b) { return sortKey[a] > sortKey[b]; });
+
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (unsigned int c : order)
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    indices.swap(result);
+}
+
+// renumbers vertices in the order the index buffer first uses them so vertex fetches walk memory sequentially;
+// vertices no triangle uses are dropped.
+inline void OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+    const unsigned int Unused = 0xffffffffu;
+    vector<unsigned int> remap(vertices.size(), Unused);
+    vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == Unused)
+        {
+            remap[index] = (unsigned int)ordered.size();
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+struct MeshOptimizationReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+};
+
+// the whole pass: weld, cache order, overdraw order, fetch order. Returns the cache statistics before and after.
+inline MeshOptimizationReport OptimizeMesh(vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+    MeshOptimizationReport report;
+    report.before = AnalyzeVertexCache(indices, vertices.size());
+    report.verticesBefore = vertices.size();
+
+    WeldVertices(vertices, indices);
+    OptimizeVertexCache(indices, vertices.size());
+    OptimizeOverdraw(indices, vertices);
+    OptimizeVertexFetch(vertices, indices);
+
+    report.after = AnalyzeVertexCache(indices, vertices.size());
+    report.verticesAfter = vertices.size();
+    return report;
+}
+#endif
@@ -0,0 +1,265 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Sum of squared distances to a set of planes, weighted by the area they came from (Garland & Heckbert 1997).
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+    double weight = 0;
+
+    // plane a*x + b*y + c*z + d = 0 with a unit normal
+    static Quadric FromPlane(double a, double b, double c, double d, double weight)
+    {
+        Quadric q;
+        q.a2 = a * a * weight; q.ab = a * b * weight; q.ac = a * c * weight; q.ad = a * d * weight;
+        q.b2 = b * b * weight; q.bc = b * c * weight; q.bd = b * d * weight;
+        q.c2 = c * c * weight; q.cd = c * d * weight;
+        q.d2 = d * d * weight;
+        q.weight = weight;
+        return q;
+    }
+
+    void Add(const Quadric &q)
+    {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+        weight += q.weight;
+    }
+
+    // mean squared distance of p to the planes
+    double Error(const glm::vec3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double error = a2 * x * x + b2 * y * y + c2 * z * z + 2 * (ab * x * y + ac * x * z + bc * y * z)
+                     + 2 * (ad * x + bd * y + cd * z) + d2;
+        return weight > 0 ? max(error, 0.0) / weight : 0.0;
+    }
+};
+
+// largest side of the bounding box, the unit simplification errors are measured in
+inline float MeshExtent(const vector<Vertex> &vertices)
+{
+    if (vertices.empty())
+        return 0.0f;
+    glm::vec3 lower = vertices[0].Position, upper = vertices[0].Position;
+    for (const Vertex &vertex : vertices)
+    {
+        lower = glm::min(lower, vertex.Position);
+        upper = glm::max(upper, vertex.Position);
+    }
+    glm::vec3 size = upper - lower;
+    return max(size.x, max(size.y, size.z));
+}
+
+// Simplifies a triangle list by quadric error edge collapses until it has at most targetIndexCount indices or the
+// next collapse would move the surface by more than targetError (relative to MeshExtent). Every collapse moves
+// a vertex onto a neighbour, so the result indexes the same vertex buffer and a LOD only needs its own index
+// buffer. Vertices on borders and on attribute seams (several vertices at one position) stay put, so the
+// silhouette of open meshes and the texture mapping hold together. resultError receives the error reached.
+inline vector<unsigned int> SimplifyMesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices,
+                                         size_t targetIndexCount, float targetError, float *resultError = nullptr)
+{
+    size_t vertexCount = vertices.size();
+    float extent = MeshExtent(vertices);
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+    // positions in a unit box, so the errors don't depend on the size of the model
+    vector<glm::vec3> positions(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        positions[i] = vertices[i].Position * scale;
+
+    vector<char> locked(vertexCount, 0);
+    struct PositionHash {
+        size_t operator()(const glm::vec3 &p) const { return (size_t)Fnv1a((const unsigned char *)&p, sizeof(p)); }
+    };
+    struct PositionEqual {
+        bool operator()(const glm::vec3 &a, const glm::vec3 &b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+    };
+    unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> byPosition(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; i++)
+    {
+        auto inserted = byPosition.emplace(vertices[i].Position, i);
+        if (!inserted.second)
+            locked[i] = locked[inserted.first->second] = 1; // seam
+    }
+    unordered_map<uint64_t, unsigned int> edgeUses(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        for (int e = 0; e < 3; e++)
+        {
+            unsigned int a = indices[i + e], b = indices[i + (e + 1) % 3];
+            edgeUses[((uint64_t)min(a, b) << 32) | max(a, b)]++;
+        }
+    }
+    for (const auto &edge : edgeUses)
+    {
+        if (edge.second != 2) // border or non manifold
+            locked[edge.first >> 32] = locked[edge.first & 0xffffffffu] = 1;
+    }
+
+    vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const glm::vec3 &p0 = positions[indices[i]], &p1 = positions[indices[i + 1]], &p2 = positions[indices[i + 2]];
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(normal);
+        if (area <= 0.0f)
+            continue;
+        normal /= area;
+        Quadric plane = Quadric::FromPlane(normal.x, normal.y, normal.z, -glm::dot(normal, p0), area);
+        for (int corner = 0; corner < 3; corner++)
+            quadrics[indices[i + corner]].Add(plane);
+    }
+
+    struct Collapse {
+        unsigned int from, to;
+        double cost;
+    };
+    double maxCost = (double)targetError * targetError;
+    double reached = 0.0;
+    vector<unsigned int> result(indices.begin(), indices.end() - indices.size() % 3);
+    vector<unsigned int> offsets, adjacency, remap(vertexCount);
+    vector<char> touched;
+    vector<Collapse> collapses;
+
+    // each pass collapses the cheapest edges that don't share triangles, then rebuilds the index list
+    while (result.size() > targetIndexCount)
+    {
+        offsets.assign(vertexCount + 1, 0);
+        for (unsigned int index : result)
+            offsets[index + 1]++;
+        partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        adjacency.resize(result.size());
+        vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < result.size(); i++)
+            adjacency[fill[result[i]]++] = (unsigned int)(i / 3);
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int e = 0; e < 3; e++)
+            {
+                unsigned int a = result[i + e], b = result[i + (e + 1) % 3];
+                if (!locked[a])
+                    collapses.push_back(Collapse{ a, b, quadrics[a].Error(positions[b]) });
+                if (!locked[b])
+                    collapses.push_back(Collapse{ b, a, quadrics[b].Error(positions[a]) });
+            }
+        }
+        sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+
+        iota(remap.begin(), remap.end(), 0u);
+        touched.assign(vertexCount, 0);
+        size_t liveIndices = result.size(), collapsed = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (collapse.cost > maxCost || liveIndices <= targetIndexCount)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // reject collapses that flip a triangle around the moving vertex
+            bool flips = false;
+            size_t removed = 0;
+            for (unsigned int a = offsets[collapse.from]; a < offsets[collapse.from + 1] && !flips; a++)
+            {
+                const unsigned int *triangle = &result[adjacency[a] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    removed++;
+                    continue;
+                }
+                glm::vec3 corner[3], moved[3];
+                for (int c = 0; c < 3; c++)
+                {
+                    corner[c] = positions[triangle[c]];
+                    moved[c] = triangle[c] == collapse.from ? positions[collapse.to] : corner[c];
+                }
+                glm::vec3 before = glm::cross(corner[1] - corner[0], corner[2] - corner[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                flips = glm::dot(before, after) <= 0.0f;
+            }
+            if (flips)
+                continue;
+
+            // freeze everything around the collapse for the rest of the pass, its triangles are about to change
+            for (unsigned int a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+                for (int c = 0; c < 3; c++)
+                    touched[result[adjacency[a] * 3 + c]] = 1;
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            reached = max(reached, collapse.cost);
+            liveIndices -= removed * 3;
+            collapsed++;
+        }
+        if (collapsed == 0)
+            break;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            result[kept++] = a;
+            result[kept++] = b;
+            result[kept++] = c;
+        }
+        result.resize(kept);
+    }
+
+    if (resultError)
+        *resultError = (float)sqrt(reached);
+    return result;
+}
+
+// one level of an automatically built LOD chain
+struct LodSettings {
+    float indexRatio; // share of the full mesh's triangles to aim for
+    float maxError;   // how far the surface may move, relative to the mesh size; reached first wins
+};
+
+inline vector<LodSettings> DefaultLodChain()
+{
+    return { { 0.5f, 0.005f }, { 0.25f, 0.01f }, { 0.125f, 0.02f }, { 0.0625f, 0.05f } };
+}
+
+// Simplifies the full mesh once per level of settings. The levels are cache optimized and share the mesh's vertices;
+// their errors are in model units and never decrease along the chain. The chain ends early once a level would save
+// less than a tenth of the triangles of the one before it.
+inline vector<MeshLod> BuildLodChain(const vector<Vertex> &vertices, const vector<unsigned int> &indices, const vector<LodSettings> &settings)
+{
+    vector<MeshLod> lods;
+    float extent = MeshExtent(vertices);
+    size_t previousCount = indices.size();
+    float previousError = 0.0f;
+    for (const LodSettings &level : settings)
+    {
+        size_t target = (size_t)(indices.size() / 3 * level.indexRatio) * 3;
+        float error = 0.0f;
+        vector<unsigned int> simplified = SimplifyMesh(vertices, indices, target, level.maxError, &error);
+        if (simplified.empty() || simplified.size() > previousCount * 9 / 10)
+            break;
+        OptimizeVertexCache(simplified, vertices.size());
+
+        MeshLod lod;
+        lod.indices.swap(simplified);
+        lod.error = max(previousError, error * extent);
+        previousCount = lod.indices.size();
+        previousError = lod.error;
+        lods.push_back(move(lod));
+    }
+    return lods;
+}
+#endif
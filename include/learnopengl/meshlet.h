@@ -0,0 +1,145 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/vertex_format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+using namespace std;
+
+// A small run of a mesh's index buffer with the bounds to cull it by: a sphere around its vertices and a cone
+// containing all its triangle normals. The run is drawn like an IndexRange.
+struct Meshlet {
+    unsigned int first = 0;
+    unsigned int count = 0;
+    int baseVertex = 0;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 1.0f; // sine of the cone's half angle; 1 if the normals spread too far to ever cull
+};
+
+// Cuts the triangles of every range into meshlets of at most maxVertices unique vertices and maxTriangles
+// triangles. Triangles keep their order, which after OptimizeMesh is spatially coherent, so each meshlet is a
+// contiguous part of a range and the index buffer doesn't change. V needs a glm::vec3 Position.
+template<typename V>
+vector<Meshlet> BuildMeshlets(const vector<V> &vertices, const vector<unsigned int> &indices, const vector<IndexRange> &ranges,
+                              unsigned int maxVertices = 64, unsigned int maxTriangles = 124)
+{
+    vector<Meshlet> meshlets;
+    vector<unsigned int> stamp(vertices.size(), 0); // meshlets.size() + 1 for the vertices of the open meshlet
+    vector<glm::vec3> normals;
+
+    auto close = [&](Meshlet &meshlet) {
+        glm::vec3 lower = vertices[indices[meshlet.first]].Position, upper = lower;
+        glm::vec3 normalSum(0.0f);
+        normals.clear();
+        for (unsigned int i = meshlet.first; i < meshlet.first + meshlet.count; i += 3)
+        {
+            const glm::vec3 &p0 = vertices[indices[i]].Position, &p1 = vertices[indices[i + 1]].Position, &p2 = vertices[indices[i + 2]].Position;
+            lower = glm::min(lower, glm::min(p0, glm::min(p1, p2)));
+            upper = glm::max(upper, glm::max(p0, glm::max(p1, p2)));
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+            if (length <= 0.0f)
+                continue;
+            normalSum += normal;
+            normals.push_back(normal / length);
+        }
+        meshlet.center = (lower + upper) * 0.5f;
+        for (unsigned int i = meshlet.first; i < meshlet.first + meshlet.count; i++)
+            meshlet.radius = max(meshlet.radius, glm::length(vertices[indices[i]].Position - meshlet.center));
+
+        // the cone's axis is the area weighted average normal; its angle reaches the normal furthest from it
+        float axisLength = glm::length(normalSum);
+        if (axisLength <= 0.0f)
+            return;
+        meshlet.coneAxis = normalSum / axisLength;
+        float minDot = 1.0f;
+        for (const glm::vec3 &normal : normals)
+            minDot = min(minDot, glm::dot(normal, meshlet.coneAxis));
+        meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : sqrt(1.0f - minDot * minDot);
+    };
+
+    // vertices of triangle i that the open meshlet doesn't have yet
+    auto freshVertices = [&](unsigned int i) {
+        unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2], open = (unsigned int)meshlets.size() + 1;
+        return (unsigned int)(stamp[a] != open) + (stamp[b] != open && b != a) + (stamp[c] != open && c != a && c != b);
+    };
+
+    for (const IndexRange &range : ranges)
+    {
+        Meshlet meshlet;
+        meshlet.first = range.first;
+        meshlet.baseVertex = range.baseVertex;
+        unsigned int uniqueVertices = 0;
+        for (unsigned int i = range.first; i + 3 <= range.first + range.count; i += 3)
+        {
+            unsigned int fresh = freshVertices(i);
+            if (meshlet.count / 3 == maxTriangles || uniqueVertices + fresh > maxVertices)
+            {
+                close(meshlet);
+                meshlets.push_back(meshlet);
+                meshlet = Meshlet();
+                meshlet.first = i;
+                meshlet.baseVertex = range.baseVertex;
+                uniqueVertices = 0;
+                fresh = freshVertices(i);
+            }
+            for (int corner = 0; corner < 3; corner++)
+                stamp[indices[i + corner]] = (unsigned int)meshlets.size() + 1;
+            uniqueVertices += fresh;
+            meshlet.count += 3;
+        }
+        if (meshlet.count > 0)
+        {
+            close(meshlet);
+            meshlets.push_back(meshlet);
+        }
+    }
+    return meshlets;
+}
+
+// view frustum as six planes facing inwards, in whatever space the matrix maps to clip space from
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // Gribb & Hartmann: each plane is the last row of the matrix plus or minus one of the others
+    static Frustum FromMatrix(const glm::mat4 &m)
+    {
+        Frustum frustum;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            for (int side = 0; side < 2; side++)
+            {
+                float sign = side == 0 ? 1.0f : -1.0f;
+                glm::vec4 plane(m[0][3] + sign * m[0][axis], m[1][3] + sign * m[1][axis],
+                                m[2][3] + sign * m[2][axis], m[3][3] + sign * m[3][axis]);
+                float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+                frustum.planes[axis * 2 + side] = length > 0.0f ? plane / length : plane;
+            }
+        }
+        return frustum;
+    }
+
+    bool IntersectsSphere(const glm::vec3 &center, float radius) const
+    {
+        for (const glm::vec4 &plane : planes)
+        {
+            if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+                return false;
+        }
+        return true;
+    }
+};
+
+// true if every triangle of a meshlet whose bounds are given in world space faces away from the camera
+inline bool MeshletBackfacing(const glm::vec3 &center, float radius, const glm::vec3 &coneAxis, float coneCutoff, const glm::vec3 &cameraPosition)
+{
+    glm::vec3 toCenter = center - cameraPosition;
+    return glm::dot(toCenter, coneAxis) >= coneCutoff * glm::length(toCenter) + radius;
+}
+#endif
@@ -0,0 +1,238 @@
+#ifndef MIP_BUILDER_H
+#define MIP_BUILDER_H
+
+#include <learnopengl/texture_cache.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+enum class MipFilter {
+    Box,    // average of the texels under each new one, what glGenerateMipmap does on most drivers
+    Kaiser, // Kaiser windowed sinc: keeps more detail in the smaller levels without aliasing
+};
+
+struct MipSettings {
+    MipFilter filter = MipFilter::Kaiser;
+    bool srgb = false;      // colour channels are sRGB encoded and get filtered as linear light; alpha never is
+    bool normalMap = false; // texels are unit vectors packed as rgb = n * 0.5 + 0.5, renormalized on every level
+};
+
+// what an image is used for, which decides how its mips are filtered. asset_cook and the runtime loaders both
+// go through TextureRoleFor and MipSettingsFor, so a cooked texture and one built at load time come out the same.
+// An image used several ways is treated as the highest.
+enum class TextureRole {
+    Colour,    // sRGB encoded: diffuse maps and images no model references
+    Data,      // linear values: specular, height
+    NormalMap,
+};
+
+// role of a material texture of the given type ("texture_diffuse", ...)
+inline TextureRole TextureRoleFor(const string &type)
+{
+    if (type == "texture_normal")
+        return TextureRole::NormalMap;
+    return type == "texture_diffuse" ? TextureRole::Colour : TextureRole::Data;
+}
+
+inline MipSettings MipSettingsFor(TextureRole role)
+{
+    MipSettings settings;
+    settings.srgb = role == TextureRole::Colour;
+    settings.normalMap = role == TextureRole::NormalMap;
+    return settings;
+}
+
+// what a texture cache of an image in this role has to have been cooked with
+inline TextureCookSettings CookSettingsFor(TextureRole role)
+{
+    MipSettings mips = MipSettingsFor(role);
+    TextureCookSettings settings;
+    settings.role = (uint32_t)role;
+    settings.mipFilter = (uint32_t)mips.filter;
+    settings.srgb = mips.srgb;
+    settings.normalMap = mips.normalMap;
+    return settings;
+}
+
+// zeroth order modified Bessel function of the first kind, for the Kaiser window
+inline double BesselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// filter weights for resampling one dimension from srcSize to dstSize texels: dstSize runs of tapCount
+// weights, each starting at sourceIndex[i * tapCount] with the out of range taps clamped to the edge
+struct MipFilterTaps {
+    int tapCount = 0;
+    vector<int> sourceIndex;
+    vector<float> weights;
+
+    MipFilterTaps(int srcSize, int dstSize, MipFilter filter)
+    {
+        const double radius = filter == MipFilter::Kaiser ? 3.0 : 0.5; // in destination texels
+        const double alpha = 4.0;
+        double scale = (double)srcSize / dstSize;
+        tapCount = (int)ceil(2.0 * radius * scale) + 1;
+        sourceIndex.resize((size_t)dstSize * tapCount);
+        weights.resize((size_t)dstSize * tapCount);
+        for (int i = 0; i < dstSize; i++)
+        {
+            double center = (i + 0.5) * scale - 0.5; // in source texels
+            int first = (int)floor(center - radius * scale);
+            double sum = 0.0;
+            for (int k = 0; k < tapCount; k++)
+            {
+                double t = (first + k - center) / scale; // distance in destination texels
+                double weight = 0.0;
+                if (filter == MipFilter::Box)
+                    weight = fabs(t) < radius ? 1.0 : (fabs(t) == radius ? 0.5 : 0.0);
+                else if (fabs(t) < radius)
+                {
+                    double sinc = t == 0.0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+                    double window = BesselI0(alpha * sqrt(1.0 - (t / radius) * (t / radius))) / BesselI0(alpha);
+                    weight = sinc * window;
+                }
+                sourceIndex[(size_t)i * tapCount + k] = min(max(first + k, 0), srcSize - 1);
+                weights[(size_t)i * tapCount + k] = (float)weight;
+                sum += weight;
+            }
+            for (int k = 0; k < tapCount; k++)
+                weights[(size_t)i * tapCount + k] = (float)(weights[(size_t)i * tapCount + k] / sum);
+        }
+    }
+};
+
+// 8 bit sRGB to linear light
+inline const float *SrgbToLinearTable()
+{
+    static const vector<float> table = [] {
+        vector<float> values(256);
+        for (int i = 0; i < 256; i++)
+        {
+            double c = i / 255.0;
+            values[i] = (float)(c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+// linear light quantized to LinearToSrgbSteps steps, to 8 bit sRGB
+static const int LinearToSrgbSteps = 16384;
+
+inline const unsigned char *LinearToSrgbTable()
+{
+    static const vector<unsigned char> table = [] {
+        vector<unsigned char> values(LinearToSrgbSteps + 1);
+        for (int i = 0; i <= LinearToSrgbSteps; i++)
+        {
+            double c = (double)i / LinearToSrgbSteps;
+            c = c <= 0.0031308 ? c * 12.92 : 1.055 * pow(c, 1.0 / 2.4) - 0.055;
+            values[i] = (unsigned char)lround(c * 255.0);
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+// Returns image with its complete mip chain. Each level is filtered from the one above it in float, separably:
+// one horizontal and one vertical pass, whose inner loops run over contiguous rows so the compiler vectorizes
+// them. Plain C++ without GL, so it runs on the worker threads that decode or cook the image, and gives the
+// same levels on every machine.
+inline ImageData BuildMipChain(const ImageData &image, const MipSettings &settings = MipSettings())
+{
+    ImageData result = image;
+    result.levels = MipLevelCount(image.width, image.height);
+    result.pixels = shared_ptr<unsigned char>(new unsigned char[result.ByteSize()], default_delete<unsigned char[]>());
+    memcpy(result.pixels.get(), image.pixels.get(), image.LevelSize(0));
+
+    const int components = image.nrComponents;
+    // the alpha channel of grey-alpha and RGBA images is coverage, never gamma encoded
+    const int colorComponents = components == 2 || components == 4 ? components - 1 : components;
+    const bool srgb = settings.srgb && !settings.normalMap;
+    const float *toLinear = SrgbToLinearTable();
+    const unsigned char *toSrgb = LinearToSrgbTable();
+
+    vector<float> level((size_t)image.width * image.height * components), rows, next;
+    const unsigned char *base = image.pixels.get();
+    for (size_t i = 0; i < level.size(); i++)
+        level[i] = srgb && (int)(i % components) < colorComponents ? toLinear[base[i]] : base[i] / 255.0f;
+
+    for (int index = 1; index < result.levels; index++)
+    {
+        int srcWidth = result.LevelWidth(index - 1), srcHeight = result.LevelHeight(index - 1);
+        int width = result.LevelWidth(index), height = result.LevelHeight(index);
+        MipFilterTaps horizontal(srcWidth, width, settings.filter), vertical(srcHeight, height, settings.filter);
+
+        // horizontal: srcWidth x srcHeight -> width x srcHeight
+        rows.assign((size_t)width * srcHeight * components, 0.0f);
+        for (int y = 0; y < srcHeight; y++)
+        {
+            const float *src = &level[(size_t)y * srcWidth * components];
+            float *dst = &rows[(size_t)y * width * components];
+            for (int x = 0; x < width; x++)
+            {
+                const int *taps = &horizontal.sourceIndex[(size_t)x * horizontal.tapCount];
+                const float *weights = &horizontal.weights[(size_t)x * horizontal.tapCount];
+                for (int k = 0; k < horizontal.tapCount; k++)
+                    for (int c = 0; c < components; c++)
+                        dst[x * components + c] += weights[k] * src[taps[k] * components + c];
+            }
+        }
+
+        // vertical: width x srcHeight -> width x height, whole rows at a time
+        size_t rowLength = (size_t)width * components;
+        next.assign(rowLength * height, 0.0f);
+        for (int y = 0; y < height; y++)
+        {
+            float *dst = &next[y * rowLength];
+            for (int k = 0; k < vertical.tapCount; k++)
+            {
+                const float *src = &rows[(size_t)vertical.sourceIndex[(size_t)y * vertical.tapCount + k] * rowLength];
+                float weight = vertical.weights[(size_t)y * vertical.tapCount + k];
+                for (size_t i = 0; i < rowLength; i++)
+                    dst[i] += weight * src[i];
+            }
+        }
+
+        // the sinc lobes can overshoot
+        for (float &value : next)
+            value = min(max(value, 0.0f), 1.0f);
+        if (settings.normalMap && components >= 3)
+        {
+            for (size_t i = 0; i < next.size(); i += components)
+            {
+                float x = next[i] * 2.0f - 1.0f, y = next[i + 1] * 2.0f - 1.0f, z = next[i + 2] * 2.0f - 1.0f;
+                float length = sqrt(x * x + y * y + z * z);
+                if (length <= 0.0f)
+                    continue;
+                next[i] = x / length * 0.5f + 0.5f;
+                next[i + 1] = y / length * 0.5f + 0.5f;
+                next[i + 2] = z / length * 0.5f + 0.5f;
+            }
+        }
+
+        unsigned char *dst = result.pixels.get() + result.LevelOffset(index);
+        for (size_t i = 0; i < next.size(); i++)
+        {
+            if (srgb && (int)(i % components) < colorComponents)
+                dst[i] = toSrgb[(int)(next[i] * LinearToSrgbSteps + 0.5f)];
+            else
+                dst[i] = (unsigned char)(next[i] * 255.0f + 0.5f);
+        }
+        level.swap(next);
+    }
+    return result;
+}
+#endif
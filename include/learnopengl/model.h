@@ -5,75 +5,515 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <stb_image.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/IOStream.hpp>
 
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/camera.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplifier.h>
+#include <learnopengl/obj_reader.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/startup_trace.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_table.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/verbose.h>
 
+#include <chrono>
 #include <string>
 #include <fstream>
+#include <iomanip>
 #include <sstream>
 #include <iostream>
+#include <iterator>
+#include <future>
 #include <map>
+#include <memory>
+#include <set>
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromFile(const char *path, const string &directory, TextureRole role = TextureRole::Colour);
 
+// Assimp file access through the mounted asset pack, so a model and the material library next to it can be
+// imported without their loose files. Anything not in the pack is opened from disk as usual.
+class AssetPackIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+    bool Exists(const char *path) const override
+    {
+        return AssetPack::Mounted()->Contains(path) || DefaultIOSystem::Exists(path);
+    }
+
+    Assimp::IOStream *Open(const char *path, const char *mode = "rb") override
+    {
+        AssetBlob blob;
+        if (strchr(mode, 'w') == nullptr)
+            blob = AssetPack::Mounted()->Find(path);
+        if (!blob)
+            return DefaultIOSystem::Open(path, mode);
+        return new BlobStream(blob);
+    }
+
+private:
+    // read-only stream over an asset pack entry
+    class BlobStream : public Assimp::IOStream
+    {
+    public:
+        explicit BlobStream(const AssetBlob &blob) : blob(blob) {}
 
+        size_t Read(void *buffer, size_t size, size_t count) override
+        {
+            if (size == 0)
+                return 0;
+            count = min(count, (blob.size - position) / size);
+            memcpy(buffer, blob.data.get() + position, count * size);
+            position += count * size;
+            return count;
+        }
+        size_t Write(const void *buffer, size_t size, size_t count) override { return 0; }
+        aiReturn Seek(size_t offset, aiOrigin origin) override
+        {
+            // like Assimp's MemoryIOStream, an offset from the end counts backwards
+            if (origin == aiOrigin_END)
+            {
+                if (offset > blob.size)
+                    return aiReturn_FAILURE;
+                position = blob.size - offset;
+                return aiReturn_SUCCESS;
+            }
+            size_t base = origin == aiOrigin_CUR ? position : 0;
+            if (offset > blob.size - base)
+                return aiReturn_FAILURE;
+            position = base + offset;
+            return aiReturn_SUCCESS;
+        }
+        size_t Tell() const override { return position; }
+        size_t FileSize() const override { return blob.size; }
+        void Flush() override {}
+
+    private:
+        AssetBlob blob;
+        size_t position = 0;
+    };
+};
+
+// vertex buffer footprint of a model in the format it was uploaded in, next to what the full format would take
+struct ModelVertexStats {
+    size_t vertexBytes = 0;
+    size_t fullVertexBytes = 0;
+    size_t fetchBytes = 0;      // vertex bytes read by one draw of the model, after the post-transform cache
+    size_t fullFetchBytes = 0;
+    size_t indexBytes = 0;
+    size_t fullIndexBytes = 0;  // with 32 bit indices throughout
+};
+
+// what the last culling, LOD selecting Draw of a model (or several, see Add) drew
+struct ModelDrawStats {
+    static const int MaxLevels = 8; // deeper levels are counted with the last one
+    unsigned int meshesPerLevel[MaxLevels] = {};
+    unsigned int meshesCulled = 0;  // outside the frustum, not drawn at all
+    unsigned int clustersDrawn = 0;
+    unsigned int clustersTotal = 0; // of the meshes drawn at full detail
+    size_t trianglesDrawn = 0;
+    size_t trianglesFull = 0;  // what the same draws would have cost at full detail without culling
+
+    void Add(const ModelDrawStats &other)
+    {
+        for (int level = 0; level < MaxLevels; level++)
+            meshesPerLevel[level] += other.meshesPerLevel[level];
+        meshesCulled += other.meshesCulled;
+        clustersDrawn += other.clustersDrawn;
+        clustersTotal += other.clustersTotal;
+        trianglesDrawn += other.trianglesDrawn;
+        trianglesFull += other.trianglesFull;
+    }
+};
+
+// when a model requests its material textures
+enum class TextureLoading {
+    Upfront,     // all of them while the model is uploaded
+    OnFirstDraw, // each once a mesh using it is first drawn, i.e. has passed culling; a placeholder is bound until then
+};
+
+// everything the CPU side of a model import produces. Building this never touches OpenGL, so it can be done on any thread.
+struct ModelData {
+    string directory;
+    vector<CachedMesh> meshes;
+};
 
 class Model
 {
 public:
+    // the Assimp post-processing every import asks for (ObjReader does the same for OBJ files); part of the mesh
+    // cache key
+    static const unsigned int ImportFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
     // model data
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    VertexFormat vertexFormat;
+    CpuRetention cpuRetention; // what the meshes keep of their geometry after the upload
+    TextureLoading textureLoading = TextureLoading::Upfront;
+    bool cullClusters = true; // draw full detail meshes cluster by cluster, see Mesh::DrawClusters
+    // also skip clusters that face away from the camera. Only for models drawn with GL_CULL_FACE: a model drawn
+    // two-sided would lose back faces the rasterizer still draws
+    bool cullBackfacingClusters = false;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, VertexFormat format = VertexFormat::Full, CpuRetention retention = CpuRetention::Release)
+        : Model(Import(path), gamma, format, retention)
     {
-        loadModel(path);
+    }
+
+    // constructor, uploads an already imported model and loads its textures right away. The meshes free their CPU
+    // copies of the geometry afterwards unless retention says otherwise.
+    // Must be called on the thread that owns the GL context.
+    Model(ModelData data, bool gamma = false, VertexFormat format = VertexFormat::Full, CpuRetention retention = CpuRetention::Release)
+        : directory(data.directory), gammaCorrection(gamma), vertexFormat(format), cpuRetention(retention)
+    {
+        uploadModel(data, nullptr);
+    }
+
+    // constructor, uploads an already imported model and requests its textures from a loader (or registry); they
+    // are bound as soon as they have been uploaded. With TextureLoading::OnFirstDraw a texture is only requested
+    // once a mesh using it gets drawn, so the loader has to outlive the model. Must be called on the thread that owns
+    // the GL context.
+    Model(ModelData data, TextureSource &loader, bool gamma = false, VertexFormat format = VertexFormat::Full,
+          CpuRetention retention = CpuRetention::Release, TextureLoading loading = TextureLoading::Upfront)
+        : directory(data.directory), gammaCorrection(gamma), vertexFormat(format), cpuRetention(retention), textureLoading(loading)
+    {
+        uploadModel(data, &loader);
+    }
+
+    // a model owns its buffers and textures, so it can be moved but not copied
+    Model(Model &&) = default;
+    Model &operator=(Model &&) = default;
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+
+    // CPU phase of loading a model: parses the file (or its mesh cache) and converts the vertices. With optimize
+    // set, a fresh import also reorders the meshes for the vertex cache, overdraw and vertex fetch (OptimizeMesh),
+    // and every mesh gets a simplified level per entry of lods (BuildLodChain). Safe to call from worker threads.
+    static ModelData Import(string const &path, bool optimize = true, const vector<LodSettings> &lods = DefaultLodChain())
+    {
+        TraceScope scope("import model", path);
+        auto start = chrono::steady_clock::now();
+        ModelData data;
+        unsigned int meshFlags = (optimize ? (unsigned int)MeshCache::Optimized : 0u) | (lods.empty() ? 0u : (unsigned int)MeshCache::Lods);
+        loadModel(path, meshFlags, lods, data);
+        if(VerboseLoading())
+            cout << "Model:: imported " << path << " (" << data.meshes.size() << " meshes) in "
+                 << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+        return data;
+    }
+
+    // Reads the meshes of a model file as they come out of the importer, before any optimization or caching.
+    // OBJ files go through ObjReader if objReader is set; other formats, and OBJ files it can't read, through
+    // Assimp with ImportFlags. False if neither could read the file. Safe to call from worker threads.
+    static bool ReadMeshes(string const &path, vector<CachedMesh> &meshes, bool objReader = false)
+    {
+        if(objReader && ObjReader::Handles(path))
+        {
+            TraceScope scope("OBJ parse", path);
+            if(ObjReader::Read(path, meshes))
+                return true;
+        }
+
+        // read file via ASSIMP
+        TraceScope parse("Assimp parse", path);
+        Assimp::Importer importer;
+        if(AssetPack::Mounted())
+            importer.SetIOHandler(new AssetPackIOSystem()); // the importer takes ownership
+        const aiScene* scene = importer.ReadFile(path, ImportFlags);
+        parse.End();
+        // check for errors
+        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+        {
+            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+            return false;
+        }
+
+        // process ASSIMP's root node recursively
+        processNode(scene->mRootNode, scene, meshes);
+        return true;
+    }
+
+    // runs Import on the pool; hand the result to the ModelData constructor on the GL thread.
+    static future<ModelData> ImportAsync(string const &path, ThreadPool &pool)
+    {
+        return pool.submit([path] { return Import(path); });
     }
 
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
+        glBindVertexArray(buffers->VAO);
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+            meshes[i].DrawBound(shader);
+        glBindVertexArray(0);
+    }
+
+    // draws every mesh at the coarsest level of detail whose error, projected at the distance of the mesh's bounding
+    // sphere, stays within maxErrorPixels. Meshes outside the frustum are skipped, and meshes drawn at full detail
+    // skip the clusters the camera can't see when cullClusters is set. modelMatrix must be the one the shader draws
+    // with; viewportHeight is in pixels.
+    void Draw(Shader &shader, const glm::mat4 &modelMatrix, const Camera &camera, const glm::mat4 &projection,
+              float viewportHeight, float maxErrorPixels = 1.0f)
+    {
+        float scale = max(glm::length(glm::vec3(modelMatrix[0])), max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        // pixels covered by one world unit at distance 1; projection[1][1] is the cotangent of half the field of view
+        float pixelsAtUnitDistance = viewportHeight * projection[1][1] * 0.5f;
+        Frustum frustum = Frustum::FromMatrix(projection * camera.GetViewMatrix());
+
+        drawStats = ModelDrawStats();
+        glBindVertexArray(buffers->VAO);
+        for(Mesh &mesh : meshes)
+        {
+            glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(mesh.boundsCenter, 1.0f));
+            drawStats.trianglesFull += mesh.LodIndexCount(0) / 3;
+            if(!frustum.IntersectsSphere(center, mesh.boundsRadius * scale))
+            {
+                drawStats.meshesCulled++;
+                continue;
+            }
+            float distance = glm::length(center - camera.Position) - mesh.boundsRadius * scale;
+            // inside the sphere nothing is far enough away to be simplified
+            int level = distance > 0.0f ? mesh.SelectLod(scale * pixelsAtUnitDistance / distance, maxErrorPixels) : 0;
+            if(level == 0 && cullClusters && !mesh.meshlets.empty())
+            {
+                ClusterDrawStats clusters = mesh.DrawClusters(shader, modelMatrix, frustum, camera.Position, cullBackfacingClusters);
+                drawStats.clustersDrawn += clusters.clustersDrawn;
+                drawStats.clustersTotal += clusters.clustersTotal;
+                drawStats.trianglesDrawn += clusters.trianglesDrawn;
+            }
+            else
+            {
+                mesh.DrawBound(shader, level);
+                drawStats.trianglesDrawn += mesh.LodIndexCount(level) / 3;
+            }
+
+            drawStats.meshesPerLevel[min(level, ModelDrawStats::MaxLevels - 1)]++;
+        }
+        glBindVertexArray(0);
+    }
+
+    // frees the GL buffers of all meshes and drops the texture handles now rather than when the model goes away.
+    // Must be called on the GL thread, like the destructor.
+    void Release()
+    {
+        if(buffers)
+            buffers->Release();
+        buffers.reset();
+        meshes.clear();
+        textures_loaded.clear();
+        texture_index.Clear();
     }
 
+    // GL thread: replaces the meshes with a fresh import of the same model (after its file changed). Textures the
+    // new materials share with the old ones are requested again before the old handles are dropped, so a
+    // registry hands out the resident ones instead of loading them anew.
+    void Reload(ModelData data, TextureSource &loader)
+    {
+        vector<Texture> previous;
+        previous.swap(textures_loaded);
+        // textures the old meshes have requested already stay requested
+        map<string, TextureHandle> requested;
+        for(const Mesh &mesh : meshes)
+            for(const Texture &texture : mesh.textures)
+                if(texture.handle && !texture.source)
+                    requested[texture.path] = texture.handle;
+        meshes.clear();
+        buffers.reset();
+        texture_index.Clear();
+        directory = data.directory;
+        uploadModel(data, &loader);
+        for(Mesh &mesh : meshes)
+        {
+            for(Texture &texture : mesh.textures)
+            {
+                auto handle = requested.find(texture.path);
+                if(texture.source && handle != requested.end())
+                {
+                    texture.handle = handle->second;
+                    texture.source = nullptr;
+                }
+            }
+        }
+    }
+
+    // material textures that haven't been requested yet because no mesh using them has been drawn
+    unsigned int DeferredTextures() const
+    {
+        set<string> files;
+        for(const Mesh &mesh : meshes)
+            for(const Texture &texture : mesh.textures)
+                if(texture.source)
+                    files.insert(texture.file);
+        return (unsigned int)files.size();
+    }
+
+    ModelVertexStats VertexStats() const { return vertexStats; }
+    ModelDrawStats DrawStats() const { return drawStats; }
+
     void SetShaderTextureNamePrefix(std::string prefix) {
         for (Mesh& mesh: meshes) {
             mesh.glslIdentifierPrefix = prefix;
         }
     }
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    MaterialTextureTable<Texture> texture_index; // hash index over textures_loaded, keyed by path and type
+    shared_ptr<MeshBufferPool> buffers;          // vertices and indices of all meshes
+    ModelVertexStats vertexStats;
+    ModelDrawStats drawStats;
+
+    // identifies the mesh processing in the cache: the flags and, if there are any, the LOD chain settings
+    static uint64_t settingsKey(unsigned int meshFlags, const vector<LodSettings> &lods)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+        uint64_t key = Fnv1a((const unsigned char *)&meshFlags, sizeof(meshFlags));
+        if(meshFlags & MeshCache::Lods)
+            key = Fnv1a((const unsigned char *)lods.data(), lods.size() * sizeof(LodSettings), key);
+        return key;
+    }
+
+    // loads a model from its mesh cache, or else through ReadMeshes, and stores the resulting meshes in data.meshes.
+    static void loadModel(string const &path, unsigned int meshFlags, const vector<LodSettings> &lods, ModelData &data)
+    {
+        // retrieve the directory path of the filepath
+        data.directory = path.substr(0, path.find_last_of('/'));
+
+        // a valid cache of a previous import lets us skip the import entirely; one made by the other OBJ reader
+        // doesn't count
+        bool objReader = ObjReaderEnabled() && ObjReader::Handles(path);
+        if(objReader)
+            meshFlags |= MeshCache::ObjParsed;
+        uint64_t key = settingsKey(meshFlags, lods);
+        TraceScope cache("read mesh cache", path);
+        if(MeshCache::load(path, ImportFlags, key, data.meshes))
             return;
+        cache.End();
+
+        if(!ReadMeshes(path, data.meshes, objReader))
+            return;
+
+        if(meshFlags & MeshCache::Optimized)
+            optimizeMeshes(path, data.meshes);
+        if(meshFlags & MeshCache::Lods)
+            buildLods(path, lods, data.meshes);
+
+        // remember the result so the next start doesn't have to import it again
+        TraceScope store("write mesh cache", path);
+        if(!MeshCache::store(path, ImportFlags, key, data.meshes))
+            cout << "WARNING::MESH_CACHE:: failed to write cache for " << path << endl;
+    }
+
+    // runs the mesh optimization pass on every mesh and, when loading is verbose, reports the post-transform cache
+    // efficiency it bought
+    static void optimizeMeshes(string const &path, vector<CachedMesh> &meshes)
+    {
+        TraceScope scope("optimize meshes", path);
+        ostringstream log;
+        log << fixed << setprecision(3);
+        for(size_t i = 0; i < meshes.size(); i++)
+        {
+            MeshOptimizationReport report = OptimizeMesh(meshes[i].vertices, meshes[i].indices);
+            if(VerboseLoading())
+                log << "MESH_OPTIMIZER:: " << path << " mesh " << i << ": ACMR " << report.before.acmr << " -> " << report.after.acmr
+                    << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << ", vertices "
+                    << report.verticesBefore << " -> " << report.verticesAfter << "\n";
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        cout << log.str() << flush; // one write, imports run on several threads
+    }
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+    // simplifies every mesh into its LOD chain and, when loading is verbose, reports the triangle counts and errors
+    // of the levels
+    static void buildLods(string const &path, const vector<LodSettings> &lods, vector<CachedMesh> &meshes)
+    {
+        TraceScope scope("build LODs", path);
+        ostringstream log;
+        for(size_t i = 0; i < meshes.size(); i++)
+        {
+            CachedMesh &mesh = meshes[i];
+            mesh.lods = BuildLodChain(mesh.vertices, mesh.indices, lods);
+            if(!VerboseLoading())
+                continue;
+            log << "MESH_SIMPLIFIER:: " << path << " mesh " << i << ": triangles " << mesh.indices.size() / 3;
+            for(const MeshLod &lod : mesh.lods)
+                log << " -> " << lod.indices.size() / 3 << " (error " << lod.error << ")";
+            log << "\n";
+        }
+        cout << log.str() << flush;
+    }
+
+    // GL phase: puts the vertices and indices of every mesh into the model's shared buffers and loads (or queues)
+    // the textures.
+    void uploadModel(ModelData &data, TextureSource *loader)
+    {
+        TraceScope scope("upload model", data.directory);
+        buffers = make_shared<MeshBufferPool>(vertexFormat);
+        size_t vertexCount = 0, indexCount = 0;
+        for(const CachedMesh &mesh : data.meshes)
+        {
+            vertexCount += mesh.vertices.size();
+            indexCount += mesh.indices.size();
+            for(const MeshLod &lod : mesh.lods)
+                indexCount += lod.indices.size();
+        }
+        // room for 32 bit indices and the alignment between meshes, whichever width they end up with
+        buffers->Reserve(vertexCount, indexCount * sizeof(unsigned int) + data.meshes.size() * 3);
+        meshes.reserve(data.meshes.size());
+        for(CachedMesh &mesh : data.meshes)
+        {
+            vector<Texture> textures;
+            for(const Texture &texture : mesh.textures)
+                textures.push_back(loadMaterialTexture(texture.path.c_str(), texture.type, loader));
+            // data is ours, the meshes take its vectors instead of copying them
+            meshes.emplace_back(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures), vertexFormat, std::move(mesh.lods), buffers);
+        }
+        buffers->Upload();
+        measureVertexStats();
+
+        size_t released = 0;
+        for(Mesh &mesh : meshes)
+            released += mesh.ReleaseCpuData(cpuRetention);
+        if(released > 0 && VerboseLoading())
+            cout << fixed << setprecision(1) << "Model:: " << directory << " released " << released / 1024.0
+                 << " KB of CPU geometry" << defaultfloat << endl;
+    }
+
+    // fills vertexStats (shown in the Assets window) and, when loading is verbose, reports it, so the compact
+    // format's savings can be compared per model
+    void measureVertexStats()
+    {
+        vertexStats = ModelVertexStats();
+        for(const Mesh &mesh : meshes)
+        {
+            size_t transformed = (size_t)(AnalyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr * (mesh.indices.size() / 3) + 0.5f);
+            vertexStats.vertexBytes += mesh.vertices.size() * mesh.VertexStride();
+            vertexStats.fullVertexBytes += mesh.vertices.size() * sizeof(Vertex);
+            vertexStats.fetchBytes += transformed * mesh.VertexStride();
+            vertexStats.fullFetchBytes += transformed * sizeof(Vertex);
+            vertexStats.indexBytes += mesh.IndexBytes();
+            vertexStats.fullIndexBytes += mesh.IndexCount() * sizeof(unsigned int);
+        }
+        if(!VerboseLoading())
+            return;
+        cout << fixed << setprecision(1) << "Model:: " << directory << " vertex buffers " << vertexStats.vertexBytes / 1024.0
+             << " KB (" << vertexStats.fullVertexBytes / 1024.0 << " KB as full floats), vertex fetch per draw "
+             << vertexStats.fetchBytes / 1024.0 << " KB (" << vertexStats.fullFetchBytes / 1024.0 << " KB), index buffers "
+             << vertexStats.indexBytes / 1024.0 << " KB (" << vertexStats.fullIndexBytes / 1024.0 << " KB as 32 bit)" << defaultfloat << endl;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    static void processNode(aiNode *node, const aiScene *scene, vector<CachedMesh> &meshes)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -86,17 +526,21 @@ private:
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, meshes);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    static CachedMesh processMesh(aiMesh *mesh, const aiScene *scene)
     {
+        TraceScope scope("processMesh");
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        CachedMesh result;
+        vector<Vertex> &vertices = result.vertices;
+        vector<unsigned int> &indices = result.indices;
+        vector<Texture> &textures = result.textures;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -165,95 +609,89 @@ private:
 
         // 1. diffuse maps
         vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        textures.insert(textures.end(), make_move_iterator(diffuseMaps.begin()), make_move_iterator(diffuseMaps.end()));
         // 2. specular maps
         vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        textures.insert(textures.end(), make_move_iterator(specularMaps.begin()), make_move_iterator(specularMaps.end()));
         // 3. normal maps
         std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        textures.insert(textures.end(), make_move_iterator(normalMaps.begin()), make_move_iterator(normalMaps.end()));
         // 4. height maps
         std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        textures.insert(textures.end(), make_move_iterator(heightMaps.begin()), make_move_iterator(heightMaps.end()));
 
 
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data, the GL objects are created later by uploadModel
+        return result;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // collects all material textures of a given type. Only the type and path are filled in here,
+    // the textures themselves are created by uploadModel.
+    static vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
     {
         vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            Texture texture;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
         }
         return textures;
     }
+
+    // loads (or queues on the loader) a single material texture, or returns the already loaded one with the same filepath.
+    Texture loadMaterialTexture(const char *path, const string &typeName, TextureSource *loader)
+    {
+        // check if texture was loaded before and if so, skip loading a new texture
+        if(const Texture *loaded = texture_index.Find(path, typeName))
+            return *loaded;
+        // the same image in another slot (e.g. diffuse and specular) shares the already loaded texture
+        if(const Texture *loaded = texture_index.FindByPath(path))
+        {
+            Texture texture = *loaded;
+            texture.type = typeName;
+            texture_index.Insert(path, typeName, texture);
+            return texture;
+        }
+        // if texture hasn't been loaded already, load it
+        Texture texture;
+        if(loader && textureLoading == TextureLoading::OnFirstDraw)
+        {
+            // a placeholder until the first draw of a mesh using it requests the texture, see Mesh::bindMaterial
+            texture.handle = make_shared<TextureSlot>();
+            texture.handle->id = loader->Placeholder();
+            texture.source = loader;
+            texture.file = this->directory + '/' + path;
+        }
+        else if(loader)
+            texture.handle = loader->Request(this->directory + '/' + path, TextureRoleFor(typeName));
+        else
+        {
+            texture.handle = make_shared<TextureSlot>();
+            texture.handle->Adopt(TextureFromFile(path, this->directory, TextureRoleFor(typeName)));
+        }
+        texture.type = typeName;
+        texture.path = path;
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        texture_index.Insert(path, typeName, texture);
+        return texture;
+    }
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+unsigned int TextureFromFile(const char *path, const string &directory, TextureRole role)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
+    ImageData image = DecodeImage(filename, role);
+    if (!image.pixels)
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    return TextureFromImage(image, role == TextureRole::Colour);
 }
+
 #endif
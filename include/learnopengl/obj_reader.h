@@ -0,0 +1,798 @@
+#ifndef OBJ_READER_H
+#define OBJ_READER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/startup_trace.h>
+#include <learnopengl/verbose.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// whether Model reads OBJ files with ObjReader rather than Assimp. Off by default until obj_check, which compares
+// the two, passes wherever the game is built; main turns it on when the OBJ_READER environment variable is set and
+// asset_cook with --obj-reader.
+inline atomic<bool> &ObjReaderEnabled()
+{
+    static atomic<bool> enabled(false);
+    return enabled;
+}
+
+// Reader for Wavefront OBJ files and their MTL materials, a fast path next to Assimp for the format all our
+// models are in. The file is mapped (or read from the asset pack), split into line aligned chunks that are parsed
+// on threads of their own, and the per chunk attributes and faces are then merged into meshes the way Assimp's OBJ
+// importer with Model's post-process flags builds them: a mesh per object and material run, a vertex per face
+// corner, polygons fanned into triangles over those, smooth normals where the file has none, tangents smoothed
+// across corners at the same position, and flipped texture coordinates.
+// Uses plain threads rather than a ThreadPool since it runs on pool workers itself. Safe to call from any thread.
+// Model only uses it when ObjReaderEnabled() is set.
+class ObjReader
+{
+public:
+    // reads path into meshes; false (with meshes left empty) if the file can't be read or uses something the
+    // reader doesn't support, the caller then falls back to Assimp. threadCount 0 uses every hardware thread.
+    static bool Read(const string &path, vector<CachedMesh> &meshes, unsigned int threadCount = 0)
+    {
+        auto start = chrono::steady_clock::now();
+        AssetBlob file = ReadAsset(path);
+        if (!file)
+            return fail(path, "can't read the file");
+        if (threadCount == 0)
+            threadCount = max(1u, thread::hardware_concurrency());
+
+        // line aligned chunks, no smaller than MinChunkSize so small files don't pay for threads they don't need
+        const char *text = (const char *)file.data.get(), *end = text + file.size;
+        size_t chunkCount = max((size_t)1, min((size_t)threadCount, file.size / MinChunkSize));
+        vector<Chunk> chunks(chunkCount);
+        const char *chunkStart = text;
+        for (size_t c = 0; c < chunkCount; c++)
+        {
+            const char *chunkEnd = c + 1 == chunkCount ? end : max(chunkStart, text + file.size * (c + 1) / chunkCount);
+            while (chunkEnd < end && chunkEnd[-1] != '\n')
+                chunkEnd++;
+            chunks[c].text = chunkStart;
+            chunks[c].end = chunkEnd;
+            chunkStart = chunkEnd;
+        }
+        parallelFor(chunkCount, threadCount, [&chunks](size_t c) { parseChunk(chunks[c]); });
+        for (const Chunk &chunk : chunks)
+            if (!chunk.error.empty())
+                return fail(path, chunk.error);
+
+        Attributes attributes;
+        gatherAttributes(chunks, threadCount, attributes);
+        string directory = path.substr(0, path.find_last_of('/'));
+        map<string, vector<Texture>> materials;
+        for (const Chunk &chunk : chunks)
+            for (const string &library : chunk.libraries)
+                readMaterials(directory + '/' + library, materials);
+
+        vector<MeshPlan> plans = planMeshes(chunks);
+        meshes.assign(plans.size(), CachedMesh());
+        vector<vector<unsigned int>> positionIndices(plans.size());
+        for (size_t m = 0; m < plans.size(); m++)
+        {
+            meshes[m].vertices.resize(plans[m].cornerCount);
+            meshes[m].indices.resize(plans[m].indexCount);
+            positionIndices[m].resize(plans[m].cornerCount);
+            auto material = materials.find(plans[m].material);
+            if (material != materials.end())
+                meshes[m].textures = material->second;
+        }
+        vector<char> valid(chunkCount, 1);
+        parallelFor(chunkCount, threadCount, [&](size_t c) { valid[c] = fillVertices(chunks[c], attributes, meshes, positionIndices); });
+        if (find(valid.begin(), valid.end(), 0) != valid.end())
+        {
+            meshes.clear();
+            return fail(path, "a face refers to a vertex attribute that doesn't exist");
+        }
+        vector<Chunk>().swap(chunks);
+
+        vector<unsigned int> canonical = canonicalPositions(attributes.positions);
+        for (size_t m = 0; m < meshes.size(); m++)
+            finishMesh(meshes[m], positionIndices[m], canonical, plans[m], threadCount);
+
+        if (VerboseLoading())
+        {
+            size_t triangles = 0;
+            for (const CachedMesh &mesh : meshes)
+                triangles += mesh.indices.size() / 3;
+            cout << "OBJ:: read " << path << " (" << meshes.size() << " meshes, " << triangles << " triangles) in "
+                 << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms on "
+                 << min((size_t)threadCount, chunkCount) << " threads" << endl;
+        }
+        return true;
+    }
+
+    // whether path names an OBJ file, by its extension
+    static bool Handles(const string &path)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == string::npos || path.size() - dot != 4)
+            return false;
+        return tolower(path[dot + 1]) == 'o' && tolower(path[dot + 2]) == 'b' && tolower(path[dot + 3]) == 'j';
+    }
+
+private:
+    static const size_t MinChunkSize = 256 * 1024;
+
+    // a face corner's indices as written; 0 is missing, above 0 a 1-based index into the whole file and below 0
+    // -(i + 1) for the i-th attribute of the chunk, which is what relative (negative) indices resolve to
+    struct Corner {
+        int position, texCoord, normal;
+    };
+
+    // a stretch of faces of one object and material. A chunk doesn't know the material (or object) that is
+    // current at its start, so its first run inherits them from the chunk before.
+    struct Run {
+        bool newObject = false;  // starts at an "o" or "g" line
+        bool hasMaterial = false; // starts at a "usemtl" line
+        string material;
+        size_t first = 0, count = 0;                 // its corners in Chunk::corners
+        size_t firstIndex = 0, indexCount = 0;       // its triangles in Chunk::triangles
+        size_t mesh = 0, offset = 0, indexOffset = 0; // where they go, filled in by planMeshes
+    };
+
+    struct Chunk {
+        const char *text = nullptr, *end = nullptr;
+        vector<glm::vec3> positions, normals;
+        vector<glm::vec2> texCoords;
+        vector<Corner> corners;          // one per corner of every face
+        vector<unsigned int> triangles; // three corners each
+        vector<Run> runs;
+        vector<string> libraries;
+        string error;
+        size_t positionBase = 0, texCoordBase = 0, normalBase = 0; // attributes in the chunks before
+    };
+
+    struct Attributes {
+        vector<glm::vec3> positions, normals;
+        vector<glm::vec2> texCoords;
+    };
+
+    struct MeshPlan {
+        string material;
+        size_t cornerCount = 0, indexCount = 0;
+        bool hasTexCoords = false;
+        bool hasNormals = false;
+    };
+
+    static bool fail(const string &path, const string &reason)
+    {
+        cout << "OBJ:: " << path << ": " << reason << ", falling back to Assimp" << endl;
+        return false;
+    }
+
+    // runs job(i) for i in [0, count) on up to threadCount threads, this one included
+    template <typename Job>
+    static void parallelFor(size_t count, unsigned int threadCount, const Job &job)
+    {
+        size_t workers = min((size_t)threadCount, count);
+        if (workers <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+                job(i);
+            return;
+        }
+        vector<thread> threads;
+        for (size_t w = 1; w < workers; w++)
+            threads.emplace_back([&job, w, workers, count] {
+                StartupTrace::Get().NameThread("OBJ reader");
+                TraceScope scope("OBJ reader thread");
+                for (size_t i = w; i < count; i += workers)
+                    job(i);
+            });
+        for (size_t i = 0; i < count; i += workers)
+            job(i);
+        for (thread &worker : threads)
+            worker.join();
+    }
+
+    // runs job(begin, end) over about equal slices of [0, count)
+    template <typename Job>
+    static void parallelRanges(size_t count, unsigned int threadCount, const Job &job)
+    {
+        size_t slices = max((size_t)1, min((size_t)threadCount, count / 4096));
+        parallelFor(slices, threadCount, [&](size_t s) { job(count * s / slices, count * (s + 1) / slices); });
+    }
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    static const char *skipSpace(const char *p, const char *end)
+    {
+        while (p < end && isSpace(*p))
+            p++;
+        return p;
+    }
+
+    static const char *lineEnd(const char *p, const char *end)
+    {
+        if (p >= end)
+            return end;
+        const char *newline = (const char *)memchr(p, '\n', end - p);
+        return newline ? newline : end;
+    }
+
+    // the rest of the line without the surrounding white space
+    static string restOfLine(const char *p, const char *end)
+    {
+        p = skipSpace(p, end);
+        while (end > p && isSpace(end[-1]))
+            end--;
+        return string(p, end);
+    }
+
+    // decimal float with an optional fraction and exponent, without the locale and error handling of strtof; the
+    // first 19 significant digits are used, which is more than a float holds. Returns p if there was no number.
+    static const char *parseFloat(const char *p, const char *end, float &value)
+    {
+        static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        const char *start = p;
+        bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            p++;
+        uint64_t mantissa = 0;
+        int exponent = 0, digits = 0;
+        bool any = false;
+        for (; p < end && *p >= '0' && *p <= '9'; p++, any = true)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits += mantissa != 0;
+            }
+            else
+                exponent++;
+        }
+        if (p < end && *p == '.')
+        {
+            for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = true)
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                    digits += mantissa != 0;
+                    exponent--;
+                }
+            }
+        }
+        if (!any)
+            return start;
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char *q = p + 1;
+            bool negativeExponent = q < end && *q == '-';
+            if (q < end && (*q == '-' || *q == '+'))
+                q++;
+            int e = 0;
+            bool anyExponent = false;
+            for (; q < end && *q >= '0' && *q <= '9'; q++, anyExponent = true)
+                e = min(e * 10 + (*q - '0'), 100000);
+            if (anyExponent)
+            {
+                exponent += negativeExponent ? -e : e;
+                p = q;
+            }
+        }
+        double result = (double)mantissa;
+        if (exponent >= 0)
+            result = exponent <= 22 ? result * powers[exponent] : result * pow(10.0, exponent);
+        else
+            result = exponent >= -22 ? result / powers[-exponent] : result * pow(10.0, exponent);
+        value = (float)(negative ? -result : result);
+        return p;
+    }
+
+    static const char *parseInt(const char *p, const char *end, int &value)
+    {
+        bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            p++;
+        int result = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            result = result * 10 + (*p - '0');
+        value = negative ? -result : result;
+        return p;
+    }
+
+    // turns an index as written into the Corner encoding; false if it can't refer to anything
+    static bool encodeIndex(int index, size_t chunkCount, int &encoded)
+    {
+        if (index > 0)
+            encoded = index;
+        else if (index < 0 && (size_t)-index <= chunkCount)
+            encoded = -(int)(chunkCount + index) - 1;
+        else
+            return false;
+        return true;
+    }
+
+    static void parseChunk(Chunk &chunk)
+    {
+        chunk.runs.push_back(Run());
+        vector<Corner> polygon;
+        const char *p = chunk.text, *end = chunk.end;
+        while (p < end)
+        {
+            p = skipSpace(p, end);
+            const char *eol = lineEnd(p, end);
+            if (p + 1 < eol && p[0] == 'v' && isSpace(p[1]))
+            {
+                glm::vec3 position(0.0f);
+                const char *q = p + 1;
+                for (int axis = 0; axis < 3; axis++)
+                    q = parseFloat(skipSpace(q, eol), eol, position[axis]);
+                chunk.positions.push_back(position);
+            }
+            else if (p + 2 < eol && p[0] == 'v' && p[1] == 't' && isSpace(p[2]))
+            {
+                glm::vec2 texCoord(0.0f);
+                const char *q = p + 2;
+                for (int axis = 0; axis < 2; axis++)
+                    q = parseFloat(skipSpace(q, eol), eol, texCoord[axis]);
+                chunk.texCoords.push_back(texCoord);
+            }
+            else if (p + 2 < eol && p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+            {
+                glm::vec3 normal(0.0f);
+                const char *q = p + 2;
+                for (int axis = 0; axis < 3; axis++)
+                    q = parseFloat(skipSpace(q, eol), eol, normal[axis]);
+                chunk.normals.push_back(normal);
+            }
+            else if (p + 1 < eol && p[0] == 'f' && isSpace(p[1]))
+            {
+                if (!parseFace(chunk, p + 1, eol, polygon))
+                {
+                    chunk.error = "malformed face \"" + restOfLine(p, eol) + "\"";
+                    return;
+                }
+            }
+            else if (eol - p > 6 && strncmp(p, "usemtl", 6) == 0 && isSpace(p[6]))
+            {
+                startRun(chunk, false);
+                chunk.runs.back().hasMaterial = true;
+                chunk.runs.back().material = restOfLine(p + 6, eol);
+            }
+            else if (p < eol && (p[0] == 'o' || p[0] == 'g') && (p + 1 == eol || isSpace(p[1])))
+                startRun(chunk, true);
+            else if (eol - p > 6 && strncmp(p, "mtllib", 6) == 0 && isSpace(p[6]))
+                chunk.libraries.push_back(restOfLine(p + 6, eol));
+            p = eol + 1;
+        }
+        closeRun(chunk);
+    }
+
+    static void closeRun(Chunk &chunk)
+    {
+        Run &current = chunk.runs.back();
+        current.count = chunk.corners.size() - current.first;
+        current.indexCount = chunk.triangles.size() - current.firstIndex;
+    }
+
+    static void startRun(Chunk &chunk, bool newObject)
+    {
+        closeRun(chunk);
+        // a run without faces only matters for what it changes
+        const Run &current = chunk.runs.back();
+        if (current.count == 0 && !current.newObject && !current.hasMaterial)
+            chunk.runs.pop_back();
+        Run run;
+        run.newObject = newObject;
+        run.first = chunk.corners.size();
+        run.firstIndex = chunk.triangles.size();
+        chunk.runs.push_back(run);
+    }
+
+    // reads the corners of an "f" line and fans triangles over them, like Assimp does for convex polygons
+    static bool parseFace(Chunk &chunk, const char *p, const char *eol, vector<Corner> &polygon)
+    {
+        polygon.clear();
+        while (true)
+        {
+            p = skipSpace(p, eol);
+            if (p >= eol)
+                break;
+            int values[3] = { 0, 0, 0 };
+            for (int slot = 0; slot < 3; slot++)
+            {
+                if (slot > 0)
+                {
+                    if (p >= eol || *p != '/')
+                        break;
+                    p++;
+                }
+                if (p < eol && (*p == '-' || (*p >= '0' && *p <= '9')))
+                    p = parseInt(p, eol, values[slot]);
+            }
+            if (p < eol && !isSpace(*p))
+                return false;
+            Corner corner = { 0, 0, 0 };
+            if (!encodeIndex(values[0], chunk.positions.size(), corner.position)
+                || (values[1] && !encodeIndex(values[1], chunk.texCoords.size(), corner.texCoord))
+                || (values[2] && !encodeIndex(values[2], chunk.normals.size(), corner.normal)))
+                return false;
+            polygon.push_back(corner);
+        }
+        // points and lines aren't drawn, Model only takes triangles
+        if (polygon.size() < 3)
+            return true;
+        unsigned int first = (unsigned int)chunk.corners.size();
+        chunk.corners.insert(chunk.corners.end(), polygon.begin(), polygon.end());
+        for (unsigned int i = 2; i < polygon.size(); i++)
+        {
+            chunk.triangles.push_back(first);
+            chunk.triangles.push_back(first + i - 1);
+            chunk.triangles.push_back(first + i);
+        }
+        return true;
+    }
+
+    // concatenates the attributes of all chunks, so faces can refer to them by their index in the file
+    static void gatherAttributes(vector<Chunk> &chunks, unsigned int threadCount, Attributes &attributes)
+    {
+        size_t positions = 0, texCoords = 0, normals = 0;
+        for (Chunk &chunk : chunks)
+        {
+            chunk.positionBase = positions;
+            chunk.texCoordBase = texCoords;
+            chunk.normalBase = normals;
+            positions += chunk.positions.size();
+            texCoords += chunk.texCoords.size();
+            normals += chunk.normals.size();
+        }
+        attributes.positions.resize(positions);
+        attributes.texCoords.resize(texCoords);
+        attributes.normals.resize(normals);
+        parallelFor(chunks.size(), threadCount, [&chunks, &attributes](size_t c) {
+            Chunk &chunk = chunks[c];
+            copy(chunk.positions.begin(), chunk.positions.end(), attributes.positions.begin() + chunk.positionBase);
+            copy(chunk.texCoords.begin(), chunk.texCoords.end(), attributes.texCoords.begin() + chunk.texCoordBase);
+            copy(chunk.normals.begin(), chunk.normals.end(), attributes.normals.begin() + chunk.normalBase);
+            vector<glm::vec3>().swap(chunk.positions);
+            vector<glm::vec2>().swap(chunk.texCoords);
+            vector<glm::vec3>().swap(chunk.normals);
+        });
+    }
+
+    // collects the maps of every material in an MTL file, in the order Model::processMesh asks Assimp for them
+    static void readMaterials(const string &path, map<string, vector<Texture>> &materials)
+    {
+        AssetBlob file = ReadAsset(path);
+        if (!file)
+        {
+            cout << "OBJ:: can't read material library " << path << endl;
+            return;
+        }
+        static const char *const types[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+        map<string, vector<Texture>> found[4]; // per type
+        string material;
+        const char *p = (const char *)file.data.get(), *end = p + file.size;
+        while (p < end)
+        {
+            p = skipSpace(p, end);
+            const char *eol = lineEnd(p, end);
+            const char *keyEnd = p;
+            while (keyEnd < eol && !isSpace(*keyEnd))
+                keyEnd++;
+            string key(p, keyEnd);
+            int type = -1;
+            if (key == "newmtl")
+            {
+                material = restOfLine(keyEnd, eol);
+                materials[material];
+            }
+            else if (key == "map_Kd")
+                type = 0;
+            else if (key == "map_Ks")
+                type = 1;
+            else if (key == "map_Bump" || key == "map_bump" || key == "bump")
+                type = 2; // Assimp's height maps, which Model treats as normal maps
+            else if (key == "map_Ka")
+                type = 3;
+            if (type >= 0)
+            {
+                Texture texture;
+                texture.type = types[type];
+                texture.path = texturePath(keyEnd, eol);
+                if (!texture.path.empty())
+                    found[type][material].push_back(texture);
+            }
+            p = eol + 1;
+        }
+        for (auto &entry : materials)
+        {
+            for (int type = 0; type < 4; type++)
+            {
+                auto textures = found[type].find(entry.first);
+                if (textures != found[type].end())
+                    entry.second.insert(entry.second.end(), textures->second.begin(), textures->second.end());
+            }
+        }
+    }
+
+    // the file name of a map statement, after its options (-bm 0.5, -o 0 0 0, -clamp on, ...)
+    static string texturePath(const char *p, const char *eol)
+    {
+        while (true)
+        {
+            p = skipSpace(p, eol);
+            if (p >= eol || *p != '-')
+                return restOfLine(p, eol);
+            // the option, then its numeric or on/off arguments
+            while (p < eol && !isSpace(*p))
+                p++;
+            while (true)
+            {
+                const char *argument = skipSpace(p, eol), *argumentEnd = argument;
+                while (argumentEnd < eol && !isSpace(*argumentEnd))
+                    argumentEnd++;
+                float number;
+                string word(argument, argumentEnd);
+                bool numeric = argument < argumentEnd && parseFloat(argument, argumentEnd, number) == argumentEnd;
+                if (!numeric && word != "on" && word != "off")
+                    break;
+                p = argumentEnd;
+            }
+        }
+    }
+
+    // merges the runs of all chunks into meshes: a new one whenever the object or the material changes, as with
+    // Assimp, which only reuses a mesh for consecutive faces. Assigns every run its place in its mesh.
+    static vector<MeshPlan> planMeshes(vector<Chunk> &chunks)
+    {
+        vector<MeshPlan> plans;
+        string material;
+        size_t object = 0, currentObject = (size_t)-1;
+        string currentMaterial;
+        for (Chunk &chunk : chunks)
+        {
+            for (Run &run : chunk.runs)
+            {
+                if (run.newObject)
+                    object++;
+                if (run.hasMaterial)
+                    material = run.material;
+                if (run.count == 0)
+                    continue;
+                if (plans.empty() || object != currentObject || material != currentMaterial)
+                {
+                    plans.push_back(MeshPlan());
+                    plans.back().material = material;
+                    currentObject = object;
+                    currentMaterial = material;
+                }
+                run.mesh = plans.size() - 1;
+                run.offset = plans.back().cornerCount;
+                run.indexOffset = plans.back().indexCount;
+                plans.back().cornerCount += run.count;
+                plans.back().indexCount += run.indexCount;
+                for (size_t i = run.first; i < run.first + run.count; i++)
+                {
+                    plans.back().hasTexCoords |= chunk.corners[i].texCoord != 0;
+                    plans.back().hasNormals |= chunk.corners[i].normal != 0;
+                }
+            }
+        }
+        return plans;
+    }
+
+    // resolves an encoded index; false if it's out of range
+    static bool resolve(int encoded, size_t base, size_t count, size_t &index)
+    {
+        index = encoded > 0 ? (size_t)encoded - 1 : base + (size_t)(-encoded - 1);
+        return index < count;
+    }
+
+    // writes a vertex per corner and the triangles of the chunk's runs into their meshes; false if an index was
+    // out of range
+    static bool fillVertices(const Chunk &chunk, const Attributes &attributes, vector<CachedMesh> &meshes,
+                             vector<vector<unsigned int>> &positionIndices)
+    {
+        for (const Run &run : chunk.runs)
+        {
+            if (run.count == 0)
+                continue;
+            CachedMesh &mesh = meshes[run.mesh];
+            for (size_t i = 0; i < run.count; i++)
+            {
+                const Corner &corner = chunk.corners[run.first + i];
+                size_t target = run.offset + i, position = 0, texCoord = 0, normal = 0;
+                if (!resolve(corner.position, chunk.positionBase, attributes.positions.size(), position)
+                    || (corner.texCoord && !resolve(corner.texCoord, chunk.texCoordBase, attributes.texCoords.size(), texCoord))
+                    || (corner.normal && !resolve(corner.normal, chunk.normalBase, attributes.normals.size(), normal)))
+                    return false;
+                Vertex &vertex = mesh.vertices[target];
+                vertex.Position = attributes.positions[position];
+                vertex.Normal = corner.normal ? attributes.normals[normal] : glm::vec3(0.0f);
+                vertex.TexCoords = corner.texCoord ? attributes.texCoords[texCoord] : glm::vec2(0.0f);
+                vertex.Tangent = glm::vec3(0.0f);
+                vertex.Bitangent = glm::vec3(0.0f);
+                positionIndices[run.mesh][target] = (unsigned int)position;
+            }
+            for (size_t i = 0; i < run.indexCount; i++)
+                mesh.indices[run.indexOffset + i] = (unsigned int)(run.offset + chunk.triangles[run.firstIndex + i] - run.first);
+        }
+        return true;
+    }
+
+    // for every position, the first position with the same coordinates: Assimp smooths across corners by where they
+    // are, not by which "v" line they use, and exporters often repeat positions
+    static vector<unsigned int> canonicalPositions(const vector<glm::vec3> &positions)
+    {
+        vector<unsigned int> canonical(positions.size());
+        size_t capacity = 16;
+        while (capacity < positions.size() * 2)
+            capacity *= 2;
+        vector<unsigned int> table(capacity, UINT_MAX);
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+            uint32_t bits[3];
+            memcpy(bits, &positions[i], sizeof(bits));
+            uint64_t hash = (bits[0] * 0x9E3779B97F4A7C15ull) ^ (bits[1] * 0xC2B2AE3D27D4EB4Full) ^ (bits[2] * 0x165667B19E3779F9ull);
+            size_t slot = (size_t)(hash ^ (hash >> 29)) & (capacity - 1);
+            while (table[slot] != UINT_MAX && memcmp(&positions[table[slot]], &positions[i], sizeof(glm::vec3)) != 0)
+                slot = (slot + 1) & (capacity - 1);
+            if (table[slot] == UINT_MAX)
+                table[slot] = (unsigned int)i;
+            canonical[i] = table[slot];
+        }
+        return canonical;
+    }
+
+    // Assimp's aiProcess_GenSmoothNormals (where the file has no normals) and aiProcess_CalcTangentSpace, then
+    // aiProcess_FlipUVs, which runs after them
+    static void finishMesh(CachedMesh &mesh, vector<unsigned int> &positionIndices, const vector<unsigned int> &canonical,
+                           const MeshPlan &plan, unsigned int threadCount)
+    {
+        vector<Vertex> &vertices = mesh.vertices;
+        if (plan.hasNormals && !plan.hasTexCoords)
+            return;
+
+        // corners grouped by position: counting sort over the range of positions the mesh uses
+        unsigned int lowest = UINT_MAX, highest = 0;
+        for (unsigned int &position : positionIndices)
+        {
+            position = canonical[position];
+            lowest = min(lowest, position);
+            highest = max(highest, position);
+        }
+        vector<unsigned int> groupStart((size_t)(highest - lowest) + 2, 0), order(vertices.size());
+        for (unsigned int position : positionIndices)
+            groupStart[position - lowest + 1]++;
+        for (size_t i = 1; i < groupStart.size(); i++)
+            groupStart[i] += groupStart[i - 1];
+        {
+            vector<unsigned int> next(groupStart.begin(), groupStart.end() - 1);
+            for (size_t corner = 0; corner < vertices.size(); corner++)
+                order[next[positionIndices[corner] - lowest]++] = (unsigned int)corner;
+        }
+        vector<unsigned int>().swap(positionIndices);
+        size_t groups = groupStart.size() - 1;
+
+        const vector<unsigned int> &indices = mesh.indices;
+        if (!plan.hasNormals)
+        {
+            // every corner starts with the normal of the last triangle using it (the triangles of a polygon share
+            // corners); degenerate triangles have none and don't count
+            for (size_t t = 0; t + 2 < indices.size(); t += 3)
+            {
+                Vertex &a = vertices[indices[t]], &b = vertices[indices[t + 1]], &c = vertices[indices[t + 2]];
+                a.Normal = b.Normal = c.Normal = normalizeSafe(glm::cross(b.Position - a.Position, c.Position - a.Position));
+            }
+            parallelRanges(groups, threadCount, [&](size_t begin, size_t end) {
+                for (size_t g = begin; g < end; g++)
+                {
+                    glm::vec3 sum(0.0f);
+                    for (unsigned int i = groupStart[g]; i < groupStart[g + 1]; i++)
+                        sum += vertices[order[i]].Normal;
+                    float length = glm::length(sum);
+                    glm::vec3 normal = length > 0.0f ? sum / length : glm::vec3(0.0f);
+                    for (unsigned int i = groupStart[g]; i < groupStart[g + 1]; i++)
+                        vertices[order[i]].Normal = normal;
+                }
+            });
+        }
+
+        if (plan.hasTexCoords)
+        {
+            // in order, as the last triangle using a corner decides its tangents
+            for (size_t t = 0; t + 2 < indices.size(); t += 3)
+                faceTangents(vertices[indices[t]], vertices[indices[t + 1]], vertices[indices[t + 2]]);
+            parallelRanges(groups, threadCount, [&](size_t begin, size_t end) {
+                vector<unsigned int> close;
+                vector<char> done;
+                for (size_t g = begin; g < end; g++)
+                    smoothTangents(vertices, &order[groupStart[g]], groupStart[g + 1] - groupStart[g], close, done);
+            });
+        }
+
+        // Assimp flips the texture coordinates after computing the tangents
+        for (Vertex &vertex : vertices)
+            vertex.TexCoords.y = 1.0f - vertex.TexCoords.y;
+    }
+
+    static glm::vec3 normalizeSafe(const glm::vec3 &v)
+    {
+        float length = glm::length(v);
+        return length > 0.0f ? v / length : glm::vec3(0.0f);
+    }
+
+    // the tangent and bitangent of a triangle from its texture coordinates, made orthogonal to each corner's normal
+    static void faceTangents(Vertex &a, Vertex &b, Vertex &c)
+    {
+        glm::vec3 v = b.Position - a.Position, w = c.Position - a.Position;
+        float sx = b.TexCoords.x - a.TexCoords.x, sy = b.TexCoords.y - a.TexCoords.y;
+        float tx = c.TexCoords.x - a.TexCoords.x, ty = c.TexCoords.y - a.TexCoords.y;
+        float direction = (tx * sy - ty * sx) < 0.0f ? -1.0f : 1.0f;
+        // all three at the same texture coordinate: use the default directions
+        if (sx * ty == sy * tx)
+        {
+            sx = 0.0f;
+            sy = 1.0f;
+            tx = 1.0f;
+            ty = 0.0f;
+        }
+        glm::vec3 tangent = (w * sy - v * ty) * direction;
+        glm::vec3 bitangent = (w * sx - v * tx) * direction;
+        for (Vertex *corner : { &a, &b, &c })
+        {
+            const glm::vec3 &normal = corner->Normal;
+            corner->Tangent = normalizeSafe(tangent - normal * glm::dot(tangent, normal));
+            corner->Bitangent = normalizeSafe(bitangent - normal * glm::dot(bitangent, normal));
+        }
+    }
+
+    // averages the tangents of corners at the same position whose normals match and whose tangent frames are within
+    // 45 degrees, like Assimp (which also counts the corner it starts from twice)
+    static void smoothTangents(vector<Vertex> &vertices, const unsigned int *group, size_t count, vector<unsigned int> &close, vector<char> &done)
+    {
+        const float normalLimit = 0.9999f, tangentLimit = 0.70710678f; // cos(45 degrees)
+        done.assign(count, 0);
+        for (size_t a = 0; a < count; a++)
+        {
+            if (done[a])
+                continue;
+            const Vertex &origin = vertices[group[a]];
+            glm::vec3 normal = origin.Normal, tangent = origin.Tangent, bitangent = origin.Bitangent;
+            close.assign(1, group[a]);
+            for (size_t b = 0; b < count; b++)
+            {
+                const Vertex &other = vertices[group[b]];
+                if (done[b] || glm::dot(other.Normal, normal) < normalLimit || glm::dot(other.Tangent, tangent) < tangentLimit
+                    || glm::dot(other.Bitangent, bitangent) < tangentLimit)
+                    continue;
+                close.push_back(group[b]);
+                done[b] = 1;
+            }
+            glm::vec3 smoothTangent(0.0f), smoothBitangent(0.0f);
+            for (unsigned int corner : close)
+            {
+                smoothTangent += vertices[corner].Tangent;
+                smoothBitangent += vertices[corner].Bitangent;
+            }
+            smoothTangent = normalizeSafe(smoothTangent);
+            smoothBitangent = normalizeSafe(smoothBitangent);
+            for (unsigned int corner : close)
+            {
+                vertices[corner].Tangent = smoothTangent;
+                vertices[corner].Bitangent = smoothBitangent;
+            }
+        }
+    }
+};
+#endif
@@ -8,102 +8,54 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <climits>
+#include <cstdlib>
 #include <common.h>
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/gl_object.h>
+#include <learnopengl/startup_trace.h>
 class Shader
 {
 public:
-    unsigned int ID;
+    GLProgram ID; // deleted with the shader, which can be moved but not copied
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-        appendShaderFolderIfNotPresent(vertexPathString);
-        appendShaderFolderIfNotPresent(fragmentPathString);
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                appendShaderFolderIfNotPresent(geometryPathString);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure& e)
+        vertexSourcePath = vertexPath;
+        fragmentSourcePath = fragmentPath;
+        appendShaderFolderIfNotPresent(vertexSourcePath);
+        appendShaderFolderIfNotPresent(fragmentSourcePath);
+        if(geometryPath != nullptr)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            geometrySourcePath = geometryPath;
+            appendShaderFolderIfNotPresent(geometrySourcePath);
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        bool built;
+        ID = GLProgram(build(built));
+    }
+    // recompiles the shader from its files (after they changed), keeping the current program if they don't compile
+    // or link. Uniforms start out at their defaults in the new program and have to be set again.
+    // ------------------------------------------------------------------------
+    bool Reload()
+    {
+        bool built;
+        GLProgram program(build(built));
+        if(!built)
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            std::cout << "SHADER:: " << vertexSourcePath << " / " << fragmentSourcePath << " failed to build, keeping the previous program" << std::endl;
+            return false;
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        ID = std::move(program);
+        std::cout << "SHADER:: reloaded " << vertexSourcePath << " / " << fragmentSourcePath << std::endl;
+        return true;
+    }
+    // whether the file at path (canonical, as FileWatcher reports it) is one of the shader's sources
+    // ------------------------------------------------------------------------
+    bool Uses(const std::string &path) const
+    {
+        return canonicalPath(vertexSourcePath) == path || canonicalPath(fragmentSourcePath) == path
+               || (!geometrySourcePath.empty() && canonicalPath(geometrySourcePath) == path);
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -171,9 +123,89 @@ public:
     }
 
 private:
+    std::string vertexSourcePath;
+    std::string fragmentSourcePath;
+    std::string geometrySourcePath; // empty without a geometry shader
+
+    // compiles and links a program from the source files; built says whether that went without errors
+    // ------------------------------------------------------------------------
+    unsigned int build(bool &built) const
+    {
+        TraceScope scope("build shader", vertexSourcePath);
+        const char *vertexPath = vertexSourcePath.c_str();
+        const char *fragmentPath = fragmentSourcePath.c_str();
+        bool geometry = !geometrySourcePath.empty();
+        // 1. retrieve the vertex/fragment source code from filePath
+        std::string vertexCode;
+        std::string fragmentCode;
+        std::string geometryCode;
+        // read through the asset pack when one is mounted, the loose files otherwise
+        AssetBlob vShaderFile = ReadAsset(vertexPath);
+        AssetBlob fShaderFile = ReadAsset(fragmentPath);
+        AssetBlob gShaderFile;
+        if(geometry)
+            gShaderFile = ReadAsset(geometrySourcePath);
+        if (!vShaderFile || !fShaderFile || (geometry && !gShaderFile))
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        }
+        if (vShaderFile)
+            vertexCode.assign((const char *)vShaderFile.data.get(), vShaderFile.size);
+        if (fShaderFile)
+            fragmentCode.assign((const char *)fShaderFile.data.get(), fShaderFile.size);
+        if (gShaderFile)
+            geometryCode.assign((const char *)gShaderFile.data.get(), gShaderFile.size);
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+        // 2. compile shaders
+        TraceScope compile("compile shaders");
+        unsigned int vertex, fragment;
+        // vertex shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        built = checkCompileErrors(vertex, "VERTEX");
+        // fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        built = checkCompileErrors(fragment, "FRAGMENT") && built;
+        // if geometry shader is given, compile geometry shader
+        unsigned int geometryShader = 0;
+        if(geometry)
+        {
+            const char * gShaderCode = geometryCode.c_str();
+            geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometryShader, 1, &gShaderCode, NULL);
+            glCompileShader(geometryShader);
+            built = checkCompileErrors(geometryShader, "GEOMETRY") && built;
+        }
+        compile.End();
+        // shader Program
+        TraceScope link("link shader");
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        if(geometry)
+            glAttachShader(program, geometryShader);
+        glLinkProgram(program);
+        built = checkCompileErrors(program, "PROGRAM") && built;
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        if(geometry)
+            glDeleteShader(geometryShader);
+        return program;
+    }
+    // absolute path with symlinks resolved, the way FileWatcher reports it
+    static std::string canonicalPath(const std::string &path)
+    {
+        char resolved[PATH_MAX];
+        return realpath(path.c_str(), resolved) ? std::string(resolved) : path;
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type) const
     {
         GLint success;
         GLchar infoLog[1024];
@@ -195,6 +227,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif
@@ -2,6 +2,7 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <learnopengl/gl_object.h>
 
 #include <string>
 #include <fstream>
@@ -16,7 +17,7 @@ void appendShaderFolderIfNotPresent(std::string& path) {
 class Shader
 {
 public:
-    unsigned int ID;
+    GLProgram ID; // deleted with the shader, which can be moved but not copied
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
@@ -70,7 +71,7 @@ public:
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
         // shader Program
-        ID = glCreateProgram();
+        ID = GLProgram::Create();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
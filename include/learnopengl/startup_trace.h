@@ -0,0 +1,272 @@
+#ifndef STARTUP_TRACE_H
+#define STARTUP_TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Records where the time goes while the program starts: named scopes (TraceScope), which nest and may run on any
+// thread, and instant marks, from Start() to Finish(). Outside of that a TraceScope costs one atomic load, so
+// programs that never start the trace (the tools) don't pay for it. The recording can be written as Chrome trace events (open it in
+// chrome://tracing or ui.perfetto.dev) and summarised per scope.
+class StartupTrace
+{
+public:
+    struct Event {
+        const char *name = ""; // a string literal
+        string detail;        // the file or shader the scope worked on, if any
+        double start = 0.0;   // microseconds since the trace began
+        double duration = 0.0;
+        unsigned int thread = 0;
+        int depth = 0;        // scopes open around it on the same thread
+        bool mark = false;    // an instant rather than a scope
+    };
+
+    static StartupTrace &Get()
+    {
+        static StartupTrace trace;
+        return trace;
+    }
+
+    bool Recording() const { return recording.load(memory_order_relaxed); }
+
+    // starts recording, with the times counted from now; before other threads use the trace
+    void Start()
+    {
+        lock_guard<mutex> lock(guard);
+        origin = chrono::steady_clock::now();
+        events.clear();
+        recording = true;
+    }
+
+    // microseconds since the trace began
+    double Now() const { return chrono::duration<double, micro>(chrono::steady_clock::now() - origin).count(); }
+
+    // small number identifying the calling thread in the trace, in the order threads first ask for one
+    static unsigned int ThreadId()
+    {
+        static atomic<unsigned int> next(0);
+        thread_local unsigned int id = ++next;
+        return id;
+    }
+
+    // scopes open on the calling thread, see TraceScope
+    static int &Depth()
+    {
+        thread_local int depth = 0;
+        return depth;
+    }
+
+    // shows the calling thread under name in the trace
+    void NameThread(const string &name)
+    {
+        lock_guard<mutex> lock(guard);
+        threadNames[ThreadId()] = name;
+    }
+
+    void Record(const Event &event)
+    {
+        lock_guard<mutex> lock(guard);
+        if (Recording())
+            events.push_back(event);
+    }
+
+    // records an instant on the calling thread, e.g. the first frame being presented
+    void Mark(const char *name)
+    {
+        if (!Recording())
+            return;
+        Event event;
+        event.name = name;
+        event.start = Now();
+        event.thread = ThreadId();
+        event.depth = Depth();
+        event.mark = true;
+        Record(event);
+    }
+
+    // stops recording. The calling thread's outermost scopes make up the startup phases of the summary.
+    void Finish()
+    {
+        lock_guard<mutex> lock(guard);
+        if (!Recording())
+            return;
+        end = Now();
+        mainThread = ThreadId();
+        recording = false;
+    }
+
+    // writes the events in the Chrome trace event format; false if the file can't be written
+    bool WriteChromeTrace(const string &path) const
+    {
+        lock_guard<mutex> lock(guard);
+        FILE *file = fopen(path.c_str(), "w");
+        if (!file)
+            return false;
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        for (const auto &thread : threadNames)
+        {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n",
+                    thread.first, escape(thread.second).c_str());
+            first = false;
+        }
+        for (const Event &event : events)
+        {
+            fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"startup\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,", first ? "" : ",\n",
+                    escape(event.name).c_str(), event.thread, event.start);
+            if (event.mark)
+                fprintf(file, "\"ph\":\"i\",\"s\":\"g\"");
+            else
+                fprintf(file, "\"ph\":\"X\",\"dur\":%.3f", event.duration);
+            if (!event.detail.empty())
+                fprintf(file, ",\"args\":{\"detail\":\"%s\"}", escape(event.detail).c_str());
+            fprintf(file, "}");
+            first = false;
+        }
+        fprintf(file, "\n]}\n");
+        return fclose(file) == 0;
+    }
+
+    // prints how long startup took, the phases the main thread went through and the time spent in each scope
+    // over all threads
+    void PrintSummary() const
+    {
+        lock_guard<mutex> lock(guard);
+        struct Total {
+            unsigned int calls = 0;
+            double time = 0.0;
+            double longest = 0.0;
+            vector<unsigned int> threads;
+        };
+        // in the order they first ran
+        vector<const char *> phaseOrder, scopeOrder;
+        map<string, Total> phases, scopes;
+        double phaseTime = 0.0;
+        size_t width = 24;
+        for (const Event &event : events)
+        {
+            if (event.mark)
+                continue;
+            width = max(width, strlen(event.name));
+            if (event.thread == mainThread && event.depth == 0)
+            {
+                if (!phases.count(event.name))
+                    phaseOrder.push_back(event.name);
+                Total &phase = phases[event.name];
+                phase.calls++;
+                phase.time += event.duration;
+                phaseTime += event.duration;
+            }
+            if (!scopes.count(event.name))
+                scopeOrder.push_back(event.name);
+            Total &scope = scopes[event.name];
+            scope.calls++;
+            scope.time += event.duration;
+            scope.longest = max(scope.longest, event.duration);
+            if (find(scope.threads.begin(), scope.threads.end(), event.thread) == scope.threads.end())
+                scope.threads.push_back(event.thread);
+        }
+        stable_sort(scopeOrder.begin(), scopeOrder.end(), [&](const char *a, const char *b) { return scopes[a].time > scopes[b].time; });
+
+        int w = (int)width;
+        printf("STARTUP:: startup took %.1f ms, %zu events recorded\n", end / 1000.0, events.size());
+        for (const Event &event : events)
+            if (event.mark)
+                printf("STARTUP::   %s at %.1f ms\n", event.name, event.start / 1000.0);
+        printf("STARTUP:: %-*s %6s %10s %6s\n", w, "main thread", "calls", "ms", "%");
+        for (const char *name : phaseOrder)
+        {
+            const Total &phase = phases[name];
+            printf("STARTUP::   %-*s %6u %10.1f %6.1f\n", w - 2, name, phase.calls, phase.time / 1000.0, 100.0 * phase.time / end);
+        }
+        printf("STARTUP::   %-*s %6s %10.1f %6.1f\n", w - 2, "(outside any scope)", "", (end - phaseTime) / 1000.0, 100.0 * (end - phaseTime) / end);
+        printf("STARTUP:: %-*s %6s %10s %10s %7s\n", w, "all threads", "calls", "total ms", "longest", "threads");
+        for (const char *name : scopeOrder)
+        {
+            const Total &scope = scopes[name];
+            printf("STARTUP::   %-*s %6u %10.1f %10.1f %7zu\n", w - 2, name, scope.calls, scope.time / 1000.0, scope.longest / 1000.0,
+                   scope.threads.size());
+        }
+        fflush(stdout);
+    }
+
+private:
+    chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+    atomic<bool> recording{ false };
+    mutable mutex guard;
+    vector<Event> events;
+    map<unsigned int, string> threadNames;
+    double end = 0.0;
+    unsigned int mainThread = 0;
+
+    StartupTrace() {}
+
+    static string escape(const string &text)
+    {
+        string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if ((unsigned char)c < 0x20)
+            {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+                escaped += code;
+            }
+            else
+                escaped += c;
+        }
+        return escaped;
+    }
+};
+
+// times the code from its construction to its destruction (or End()) as a scope of the startup trace. name has
+// to be a string literal. Does nothing once the trace has finished.
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name, const string &detail = string())
+    {
+        StartupTrace &trace = StartupTrace::Get();
+        if (!trace.Recording())
+            return;
+        event.name = name;
+        event.detail = detail;
+        event.start = trace.Now();
+        event.thread = StartupTrace::ThreadId();
+        event.depth = StartupTrace::Depth()++;
+        active = true;
+    }
+
+    ~TraceScope() { End(); }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    // ends the scope before the end of the block
+    void End()
+    {
+        if (!active)
+            return;
+        active = false;
+        StartupTrace::Depth()--;
+        StartupTrace &trace = StartupTrace::Get();
+        event.duration = trace.Now() - event.start;
+        trace.Record(event);
+    }
+
+private:
+    StartupTrace::Event event;
+    bool active = false;
+};
+#endif
@@ -0,0 +1,180 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/mapped_file.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+using namespace std;
+
+// GPU block compression of a texture, see texture_compression.h. The values are stored in texture caches.
+enum class BlockFormat : uint32_t {
+    None = 0, // plain 8 bit texels
+    BC1  = 1, // RGB, 8 bytes per 4x4 block
+    BC3  = 3, // RGBA: a BC4 alpha block and a BC1 colour block
+    BC5  = 5, // two BC4 channels, x and y of a normal map
+    BC7  = 7, // RGBA, 16 bytes per block, far better colour than BC1/BC3
+};
+
+// bytes per 4x4 block
+inline size_t BlockBytes(BlockFormat format)
+{
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+// pixels of a decoded image, produced on a worker thread and uploaded on the GL thread.
+struct ImageData {
+    shared_ptr<unsigned char> pixels;
+    int width = 0;
+    int height = 0;
+    int nrComponents = 0; // of the source image, also when the pixels are block compressed
+    int levels = 1; // mip levels stored back to back in pixels, tightly packed (see BuildMipChain)
+    BlockFormat block = BlockFormat::None;
+
+    int LevelWidth(int level) const { return max(1, width >> level); }
+    int LevelHeight(int level) const { return max(1, height >> level); }
+    size_t LevelSize(int level) const
+    {
+        if (block != BlockFormat::None)
+            return (size_t)((LevelWidth(level) + 3) / 4) * ((LevelHeight(level) + 3) / 4) * BlockBytes(block);
+        return (size_t)LevelWidth(level) * LevelHeight(level) * nrComponents;
+    }
+
+    size_t LevelOffset(int level) const
+    {
+        size_t offset = 0;
+        for (int i = 0; i < level; i++)
+            offset += LevelSize(i);
+        return offset;
+    }
+
+    // bytes of all levels together
+    size_t ByteSize() const { return LevelOffset(levels); }
+};
+
+// number of levels in a full mip chain down to 1x1
+inline int MipLevelCount(int width, int height)
+{
+    int levels = 1;
+    while ((max(width, height) >> levels) > 0)
+        levels++;
+    return levels;
+}
+
+// how the mips of a cooked texture were filtered: the role of the image and the MipSettings it got (see
+// CookSettingsFor in mip_builder.h). Stored with the texture, so one cooked for another role isn't served for this one.
+struct TextureCookSettings {
+    uint32_t role = 0;      // TextureRole
+    uint32_t mipFilter = 0; // MipFilter
+    uint32_t srgb = 0;
+    uint32_t normalMap = 0;
+
+    bool operator==(const TextureCookSettings &other) const
+    {
+        return role == other.role && mipFilter == other.mipFilter && srgb == other.srgb && normalMap == other.normalMap;
+    }
+    bool operator!=(const TextureCookSettings &other) const { return !(*this == other); }
+};
+
+// Cooked texture stored next to the source image as "<source>.texcache": the decoded (or block compressed)
+// pixels with their full mip chain, ready to be handed to glTexImage2D or glCompressedTexImage2D level by level.
+// The cache is keyed by the source size, mtime and content hash and by the cook settings; written by the asset_cook tool and mapped
+// straight into memory at runtime, so loading a cooked texture costs neither the JPEG/PNG decode nor the mipmap
+// generation.
+class TextureCache
+{
+public:
+    static const uint32_t Version = 4;
+
+    static string cachePathFor(const string &sourcePath)
+    {
+        return sourcePath + ".texcache";
+    }
+
+    // maps the cooked image of sourcePath, from the asset pack if it has one; image.pixels keeps the mapping alive.
+    // False if there's no usable cache, or it was cooked with other settings.
+    static bool load(const string &sourcePath, const TextureCookSettings &settings, ImageData &image)
+    {
+        AssetBlob file = ReadAsset(cachePathFor(sourcePath));
+        if (!file)
+            return false;
+
+        Header header;
+        if (file.size < sizeof(header))
+            return reject(sourcePath, "bad header");
+        memcpy(&header, file.data.get(), sizeof(header));
+        if (memcmp(header.magic, magicTag(), sizeof(header.magic)) != 0 || header.version != Version)
+            return reject(sourcePath, "bad header");
+        // a packed cache may be all there is and is trusted when its source isn't around; an edited source makes it
+        // as stale as a loose cache
+        if ((!file.packed || access(sourcePath.c_str(), F_OK) == 0) && !header.source.Matches(sourcePath))
+            return reject(sourcePath, "source changed");
+        if (header.settings != settings)
+            return reject(sourcePath, "cooked for another role or mip filter");
+
+        ImageData cooked;
+        cooked.width = (int)header.width;
+        cooked.height = (int)header.height;
+        cooked.nrComponents = (int)header.components;
+        cooked.levels = (int)header.levels;
+        cooked.block = (BlockFormat)header.block;
+        if (header.block != 0 && header.block != 1 && header.block != 3 && header.block != 5 && header.block != 7)
+            return reject(sourcePath, "unknown block format");
+        if (cooked.width <= 0 || cooked.height <= 0 || cooked.nrComponents < 1 || cooked.nrComponents > 4
+            || cooked.levels < 1 || cooked.levels > MipLevelCount(cooked.width, cooked.height)
+            || file.size - sizeof(header) != cooked.ByteSize())
+            return reject(sourcePath, "truncated");
+
+        // pixels aren't checksummed: a corrupt texel shows up as a wrong colour, unlike a corrupt index buffer
+        cooked.pixels = shared_ptr<unsigned char>(file.data, (unsigned char *)file.data.get() + sizeof(header));
+        image = cooked;
+        return true;
+    }
+
+    // writes the cooked image for sourcePath, replacing the old cache atomically.
+    static bool store(const string &sourcePath, const TextureCookSettings &settings, const ImageData &image)
+    {
+        Header header;
+        if (!image.pixels || !SourceStamp::Of(sourcePath, header.source))
+            return false;
+        memcpy(header.magic, magicTag(), sizeof(header.magic));
+        header.version = Version;
+        header.width = (uint32_t)image.width;
+        header.height = (uint32_t)image.height;
+        header.components = (uint32_t)image.nrComponents;
+        header.levels = (uint32_t)image.levels;
+        header.block = (uint32_t)image.block;
+        header.settings = settings;
+
+        return WriteFileAtomic(cachePathFor(sourcePath), {
+            { &header, sizeof(header) },
+            { image.pixels.get(), image.ByteSize() } });
+    }
+
+private:
+    static const char *magicTag() { return "LOGLTEX"; }
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t components;
+        uint32_t levels;
+        uint32_t block;      // BlockFormat
+        SourceStamp source;
+        TextureCookSettings settings;
+    };
+
+    static bool reject(const string &sourcePath, const char *reason)
+    {
+        cout << "TEXTURE_CACHE:: ignoring cooked texture of " << sourcePath << " (" << reason << ")" << endl;
+        return false;
+    }
+};
+#endif
@@ -0,0 +1,684 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/texture_cache.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+using namespace std;
+
+// S3TC and BPTC are extensions to the 3.3 core profile glad was generated for; RGTC (BC5) is core
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+inline GLenum BlockInternalFormat(BlockFormat format)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default: return 0;
+    }
+}
+
+inline const char *BlockFormatName(BlockFormat format)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    case BlockFormat::BC5: return "BC5";
+    case BlockFormat::BC7: return "BC7";
+    default: return "uncompressed";
+    }
+}
+
+// formats the GL context can sample, one bit per BlockFormat value. Until DetectBlockFormats has run only the
+// core ones are assumed.
+inline atomic<uint32_t> &SupportedBlockFormats()
+{
+    static atomic<uint32_t> mask((1u << (uint32_t)BlockFormat::None) | (1u << (uint32_t)BlockFormat::BC5));
+    return mask;
+}
+
+inline bool BlockFormatSupported(BlockFormat format)
+{
+    return (SupportedBlockFormats().load() >> (uint32_t)format) & 1u;
+}
+
+// GL thread: looks up which block formats the driver supports
+inline void DetectBlockFormats()
+{
+    uint32_t mask = (1u << (uint32_t)BlockFormat::None) | (1u << (uint32_t)BlockFormat::BC5);
+    GLint count = 0, major = 0, minor = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (!name)
+            continue;
+        if (strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+            mask |= (1u << (uint32_t)BlockFormat::BC1) | (1u << (uint32_t)BlockFormat::BC3);
+        else if (strcmp(name, "GL_ARB_texture_compression_bptc") == 0)
+            mask |= 1u << (uint32_t)BlockFormat::BC7;
+    }
+    if (major > 4 || (major == 4 && minor >= 2))
+        mask |= 1u << (uint32_t)BlockFormat::BC7;
+    SupportedBlockFormats() = mask;
+}
+
+// the 4x4 texels at block (bx, by) of a level as RGBA; grey images are spread over RGB and blocks hanging over
+// the edge repeat the last row and column
+inline void LoadBlock(const unsigned char *pixels, int width, int height, int components, int bx, int by, unsigned char rgba[16][4])
+{
+    for (int y = 0; y < 4; y++)
+    {
+        for (int x = 0; x < 4; x++)
+        {
+            const unsigned char *texel = pixels + ((size_t)min(by * 4 + y, height - 1) * width + min(bx * 4 + x, width - 1)) * components;
+            unsigned char *out = rgba[y * 4 + x];
+            if (components < 3)
+            {
+                out[0] = out[1] = out[2] = texel[0];
+                out[3] = components == 2 ? texel[1] : 255;
+            }
+            else
+            {
+                out[0] = texel[0];
+                out[1] = texel[1];
+                out[2] = texel[2];
+                out[3] = components == 4 ? texel[3] : 255;
+            }
+        }
+    }
+}
+
+// Principal axis of a set of points in N dimensions by power iteration on their covariance; the endpoints of
+// every encoder below are fitted along it. Works on planar float arrays so the loops over the 16 texels vectorize.
+template<int N>
+inline void PrincipalAxis(const float (&channels)[N][16], float (&mean)[N], float (&axis)[N])
+{
+    for (int c = 0; c < N; c++)
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < 16; i++)
+            sum += channels[c][i];
+        mean[c] = sum / 16.0f;
+    }
+    float covariance[N][N];
+    for (int a = 0; a < N; a++)
+    {
+        for (int b = a; b < N; b++)
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < 16; i++)
+                sum += (channels[a][i] - mean[a]) * (channels[b][i] - mean[b]);
+            covariance[a][b] = covariance[b][a] = sum;
+        }
+    }
+    // start along the channel that varies most. A fixed start like (1, 1, 1) fails on blocks whose texels all have
+    // the same r + g + b: their covariance maps it to zero and the block would be encoded as one solid colour.
+    int widest = 0;
+    for (int c = 0; c < N; c++)
+    {
+        axis[c] = 0.0f;
+        if (covariance[c][c] > covariance[widest][widest])
+            widest = c;
+    }
+    axis[widest] = 1.0f;
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[N], length = 0.0f;
+        for (int a = 0; a < N; a++)
+        {
+            next[a] = 0.0f;
+            for (int b = 0; b < N; b++)
+                next[a] += covariance[a][b] * axis[b];
+            length = max(length, fabs(next[a]));
+        }
+        if (length <= 0.0f)
+            return; // a flat block, any axis will do
+        for (int a = 0; a < N; a++)
+            axis[a] = next[a] / length;
+    }
+}
+
+inline uint16_t PackRgb565(const float color[3])
+{
+    int r = (int)lround(max(0.0f, min(255.0f, color[0])) * 31.0f / 255.0f);
+    int g = (int)lround(max(0.0f, min(255.0f, color[1])) * 63.0f / 255.0f);
+    int b = (int)lround(max(0.0f, min(255.0f, color[2])) * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void UnpackRgb565(uint16_t packed, float color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (float)((r << 3) | (r >> 2));
+    color[1] = (float)((g << 2) | (g >> 4));
+    color[2] = (float)((b << 3) | (b >> 2));
+}
+
+// BC1 colour block in four colour mode: endpoints at the ends of the principal axis, refined once by least
+// squares over the chosen indices
+inline void EncodeBC1Block(const unsigned char rgba[16][4], unsigned char out[8])
+{
+    float channels[3][16];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            channels[c][i] = rgba[i][c];
+    float mean[3], axis[3];
+    PrincipalAxis<3>(channels, mean, axis);
+
+    float lowest = 1e30f, highest = -1e30f;
+    float endpoints[2][3] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        float t = (channels[0][i] - mean[0]) * axis[0] + (channels[1][i] - mean[1]) * axis[1] + (channels[2][i] - mean[2]) * axis[2];
+        if (t > highest)
+        {
+            highest = t;
+            for (int c = 0; c < 3; c++)
+                endpoints[0][c] = channels[c][i];
+        }
+        if (t < lowest)
+        {
+            lowest = t;
+            for (int c = 0; c < 3; c++)
+                endpoints[1][c] = channels[c][i];
+        }
+    }
+
+    uint16_t best0 = 0, best1 = 0;
+    unsigned char bestIndices[16] = {};
+    float bestError = 1e30f;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        uint16_t c0 = PackRgb565(endpoints[0]), c1 = PackRgb565(endpoints[1]);
+        if (c0 < c1)
+            swap(c0, c1);
+        float palette[4][3];
+        UnpackRgb565(c0, palette[0]);
+        UnpackRgb565(c1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+
+        unsigned char indices[16];
+        float error = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            float nearest = 1e30f;
+            indices[i] = 0;
+            for (int p = 0; p < (c0 == c1 ? 1 : 4); p++)
+            {
+                float dr = channels[0][i] - palette[p][0], dg = channels[1][i] - palette[p][1], db = channels[2][i] - palette[p][2];
+                float distance = dr * dr + dg * dg + db * db;
+                if (distance < nearest)
+                {
+                    nearest = distance;
+                    indices[i] = (unsigned char)p;
+                }
+            }
+            error += nearest;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            best0 = c0;
+            best1 = c1;
+            memcpy(bestIndices, indices, sizeof(indices));
+        }
+        if (c0 == c1)
+            break;
+
+        // least squares endpoints for these indices: every texel is w * c0 + (1 - w) * c1
+        static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = {}, bx[3] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            float w = weights[indices[i]];
+            aa += w * w;
+            ab += w * (1.0f - w);
+            bb += (1.0f - w) * (1.0f - w);
+            for (int c = 0; c < 3; c++)
+            {
+                ax[c] += w * channels[c][i];
+                bx[c] += (1.0f - w) * channels[c][i];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (fabs(determinant) < 1e-6f)
+            break;
+        for (int c = 0; c < 3; c++)
+        {
+            endpoints[0][c] = (bb * ax[c] - ab * bx[c]) / determinant;
+            endpoints[1][c] = (aa * bx[c] - ab * ax[c]) / determinant;
+        }
+    }
+
+    out[0] = (unsigned char)(best0 & 0xff);
+    out[1] = (unsigned char)(best0 >> 8);
+    out[2] = (unsigned char)(best1 & 0xff);
+    out[3] = (unsigned char)(best1 >> 8);
+    for (int row = 0; row < 4; row++)
+        out[4 + row] = (unsigned char)(bestIndices[row * 4] | (bestIndices[row * 4 + 1] << 2) | (bestIndices[row * 4 + 2] << 4) | (bestIndices[row * 4 + 3] << 6));
+}
+
+// BC4 block of one channel: the range of the block split into eight steps
+inline void EncodeBC4Block(const unsigned char values[16], unsigned char out[8])
+{
+    unsigned char lowest = 255, highest = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        lowest = min(lowest, values[i]);
+        highest = max(highest, values[i]);
+    }
+    out[0] = highest;
+    out[1] = lowest;
+    uint64_t bits = 0;
+    if (highest > lowest)
+    {
+        float palette[8];
+        palette[0] = highest;
+        palette[1] = lowest;
+        for (int p = 2; p < 8; p++)
+            palette[p] = ((8 - p) * (float)highest + (p - 1) * (float)lowest) / 7.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            int nearest = 0;
+            for (int p = 1; p < 8; p++)
+                if (fabs(values[i] - palette[p]) < fabs(values[i] - palette[nearest]))
+                    nearest = p;
+            bits |= (uint64_t)nearest << (3 * i);
+        }
+    }
+    for (int b = 0; b < 6; b++)
+        out[2 + b] = (unsigned char)(bits >> (8 * b));
+}
+
+// 128 bit little endian bit stream, as BC7 blocks are laid out
+struct BlockBits {
+    uint64_t word[2] = { 0, 0 };
+    int position = 0;
+
+    void Write(uint32_t value, int count)
+    {
+        for (int i = 0; i < count; i++, position++)
+            word[position >> 6] |= (uint64_t)((value >> i) & 1u) << (position & 63);
+    }
+
+    uint32_t Read(int count)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++, position++)
+            value |= (uint32_t)((word[position >> 6] >> (position & 63)) & 1u) << i;
+        return value;
+    }
+};
+
+static const int BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a shared lowest bit each, 4 bit indices
+inline void EncodeBC7Block(const unsigned char rgba[16][4], unsigned char out[16])
+{
+    float channels[4][16];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            channels[c][i] = rgba[i][c];
+    float mean[4], axis[4];
+    PrincipalAxis<4>(channels, mean, axis);
+
+    float lowest = 1e30f, highest = -1e30f;
+    float endpoints[2][4] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < 4; c++)
+            t += (channels[c][i] - mean[c]) * axis[c];
+        if (t < lowest)
+        {
+            lowest = t;
+            for (int c = 0; c < 4; c++)
+                endpoints[0][c] = channels[c][i];
+        }
+        if (t > highest)
+        {
+            highest = t;
+            for (int c = 0; c < 4; c++)
+                endpoints[1][c] = channels[c][i];
+        }
+    }
+
+    int bestQuantized[2][4] = {}, bestP[2] = {};
+    unsigned char bestIndices[16] = {};
+    float bestError = 1e30f;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        // 7 bit endpoints, with whichever lowest bit lands closer
+        int quantized[2][4], p[2];
+        float values[2][4];
+        for (int e = 0; e < 2; e++)
+        {
+            float lowestError = 1e30f;
+            for (int bit = 0; bit < 2; bit++)
+            {
+                int q[4];
+                float error = 0.0f;
+                for (int c = 0; c < 4; c++)
+                {
+                    q[c] = (int)lround((max(0.0f, min(255.0f, endpoints[e][c])) - bit) / 2.0f);
+                    q[c] = max(0, min(127, q[c]));
+                    float value = (float)((q[c] << 1) | bit);
+                    error += (value - endpoints[e][c]) * (value - endpoints[e][c]);
+                }
+                if (error < lowestError)
+                {
+                    lowestError = error;
+                    p[e] = bit;
+                    for (int c = 0; c < 4; c++)
+                    {
+                        quantized[e][c] = q[c];
+                        values[e][c] = (float)((q[c] << 1) | bit);
+                    }
+                }
+            }
+        }
+
+        float palette[16][4];
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 4; c++)
+                palette[i][c] = (float)(((64 - BC7Weights4[i]) * (int)values[0][c] + BC7Weights4[i] * (int)values[1][c] + 32) >> 6);
+        unsigned char indices[16];
+        float error = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            float nearest = 1e30f;
+            indices[i] = 0;
+            for (int k = 0; k < 16; k++)
+            {
+                float distance = 0.0f;
+                for (int c = 0; c < 4; c++)
+                    distance += (channels[c][i] - palette[k][c]) * (channels[c][i] - palette[k][c]);
+                if (distance < nearest)
+                {
+                    nearest = distance;
+                    indices[i] = (unsigned char)k;
+                }
+            }
+            error += nearest;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            memcpy(bestQuantized, quantized, sizeof(quantized));
+            memcpy(bestP, p, sizeof(p));
+            memcpy(bestIndices, indices, sizeof(indices));
+        }
+
+        // least squares refit of the endpoints to the indices
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            float w = BC7Weights4[indices[i]] / 64.0f;
+            aa += (1.0f - w) * (1.0f - w);
+            ab += w * (1.0f - w);
+            bb += w * w;
+            for (int c = 0; c < 4; c++)
+            {
+                ax[c] += (1.0f - w) * channels[c][i];
+                bx[c] += w * channels[c][i];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (fabs(determinant) < 1e-6f)
+            break;
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = (bb * ax[c] - ab * bx[c]) / determinant;
+            endpoints[1][c] = (aa * bx[c] - ab * ax[c]) / determinant;
+        }
+    }
+
+    // the first index is stored with 3 bits, so its top bit must be clear: swap the endpoints if it isn't
+    if (bestIndices[0] & 8)
+    {
+        for (int c = 0; c < 4; c++)
+            swap(bestQuantized[0][c], bestQuantized[1][c]);
+        swap(bestP[0], bestP[1]);
+        for (int i = 0; i < 16; i++)
+            bestIndices[i] = (unsigned char)(15 - bestIndices[i]);
+    }
+
+    BlockBits bits;
+    bits.Write(1u << 6, 7); // mode 6
+    for (int c = 0; c < 4; c++)
+    {
+        bits.Write((uint32_t)bestQuantized[0][c], 7);
+        bits.Write((uint32_t)bestQuantized[1][c], 7);
+    }
+    bits.Write((uint32_t)bestP[0], 1);
+    bits.Write((uint32_t)bestP[1], 1);
+    for (int i = 0; i < 16; i++)
+        bits.Write(bestIndices[i], i == 0 ? 3 : 4);
+    memcpy(out, bits.word, 16);
+}
+
+inline void DecodeBC1Block(const unsigned char in[8], unsigned char rgba[16][4], bool fourColors)
+{
+    uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8)), c1 = (uint16_t)(in[2] | (in[3] << 8));
+    float palette[4][4];
+    UnpackRgb565(c0, palette[0]);
+    UnpackRgb565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255.0f;
+    for (int c = 0; c < 3; c++)
+    {
+        if (fourColors || c0 > c1)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+            palette[3][c] = 0.0f;
+        }
+    }
+    if (!fourColors && c0 <= c1)
+        palette[3][3] = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        int index = (in[4 + i / 4] >> (2 * (i % 4))) & 3;
+        for (int c = 0; c < 4; c++)
+            rgba[i][c] = (unsigned char)lround(palette[index][c]);
+    }
+}
+
+inline void DecodeBC4Block(const unsigned char in[8], unsigned char values[16])
+{
+    float palette[8];
+    palette[0] = in[0];
+    palette[1] = in[1];
+    for (int p = 2; p < 8; p++)
+    {
+        if (in[0] > in[1])
+            palette[p] = ((8 - p) * (float)in[0] + (p - 1) * (float)in[1]) / 7.0f;
+        else if (p < 6)
+            palette[p] = ((6 - p) * (float)in[0] + (p - 1) * (float)in[1]) / 5.0f;
+        else
+            palette[p] = p == 6 ? 0.0f : 255.0f;
+    }
+    uint64_t bits = 0;
+    for (int b = 0; b < 6; b++)
+        bits |= (uint64_t)in[2 + b] << (8 * b);
+    for (int i = 0; i < 16; i++)
+        values[i] = (unsigned char)lround(palette[(bits >> (3 * i)) & 7]);
+}
+
+// decodes the mode 6 blocks EncodeBC7Block writes; blocks of any other mode come out black
+inline void DecodeBC7Block(const unsigned char in[16], unsigned char rgba[16][4])
+{
+    BlockBits bits;
+    memcpy(bits.word, in, 16);
+    if (bits.Read(7) != (1u << 6))
+    {
+        memset(rgba, 0, 16 * 4);
+        return;
+    }
+    int endpoints[2][4];
+    for (int c = 0; c < 4; c++)
+    {
+        endpoints[0][c] = (int)bits.Read(7);
+        endpoints[1][c] = (int)bits.Read(7);
+    }
+    int p0 = (int)bits.Read(1), p1 = (int)bits.Read(1);
+    for (int c = 0; c < 4; c++)
+    {
+        endpoints[0][c] = (endpoints[0][c] << 1) | p0;
+        endpoints[1][c] = (endpoints[1][c] << 1) | p1;
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        int w = BC7Weights4[bits.Read(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; c++)
+            rgba[i][c] = (unsigned char)(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+    }
+}
+
+// Block compresses every level of an uncompressed image. BC5 keeps the first two channels (x and y of a normal
+// map, shaders rebuild z); the others encode RGB(A).
+inline ImageData CompressImage(const ImageData &image, BlockFormat format)
+{
+    ImageData result = image;
+    result.block = format;
+    if (!image.pixels || image.block != BlockFormat::None || format == BlockFormat::None)
+    {
+        result.block = image.block;
+        return result;
+    }
+    result.pixels = shared_ptr<unsigned char>(new unsigned char[result.ByteSize()], default_delete<unsigned char[]>());
+
+    for (int level = 0; level < image.levels; level++)
+    {
+        const unsigned char *src = image.pixels.get() + image.LevelOffset(level);
+        unsigned char *dst = result.pixels.get() + result.LevelOffset(level);
+        int width = image.LevelWidth(level), height = image.LevelHeight(level);
+        for (int by = 0; by < (height + 3) / 4; by++)
+        {
+            for (int bx = 0; bx < (width + 3) / 4; bx++)
+            {
+                unsigned char rgba[16][4], channel[16];
+                LoadBlock(src, width, height, image.nrComponents, bx, by, rgba);
+                switch (format)
+                {
+                case BlockFormat::BC1:
+                    EncodeBC1Block(rgba, dst);
+                    break;
+                case BlockFormat::BC3:
+                    for (int i = 0; i < 16; i++)
+                        channel[i] = rgba[i][3];
+                    EncodeBC4Block(channel, dst);
+                    EncodeBC1Block(rgba, dst + 8);
+                    break;
+                case BlockFormat::BC5:
+                    for (int c = 0; c < 2; c++)
+                    {
+                        for (int i = 0; i < 16; i++)
+                            channel[i] = rgba[i][c];
+                        EncodeBC4Block(channel, dst + 8 * c);
+                    }
+                    break;
+                default:
+                    EncodeBC7Block(rgba, dst);
+                    break;
+                }
+                dst += BlockBytes(format);
+            }
+        }
+    }
+    return result;
+}
+
+// Decodes a block compressed image back to 8 bit texels, for drivers without the format: RGBA for BC1, BC3
+// and BC7, RGB with blue at 0 for BC5, as sampling it would give.
+inline ImageData DecompressImage(const ImageData &image)
+{
+    ImageData result = image;
+    result.block = BlockFormat::None;
+    if (!image.pixels || image.block == BlockFormat::None)
+    {
+        result.block = image.block;
+        return result;
+    }
+    result.nrComponents = image.block == BlockFormat::BC5 ? 3 : 4;
+    result.pixels = shared_ptr<unsigned char>(new unsigned char[result.ByteSize()], default_delete<unsigned char[]>());
+
+    for (int level = 0; level < image.levels; level++)
+    {
+        const unsigned char *src = image.pixels.get() + image.LevelOffset(level);
+        unsigned char *dst = result.pixels.get() + result.LevelOffset(level);
+        int width = image.LevelWidth(level), height = image.LevelHeight(level), components = result.nrComponents;
+        for (int by = 0; by < (height + 3) / 4; by++)
+        {
+            for (int bx = 0; bx < (width + 3) / 4; bx++)
+            {
+                unsigned char rgba[16][4], channel[16];
+                switch (image.block)
+                {
+                case BlockFormat::BC1:
+                    DecodeBC1Block(src, rgba, false);
+                    break;
+                case BlockFormat::BC3:
+                    DecodeBC1Block(src + 8, rgba, true);
+                    DecodeBC4Block(src, channel);
+                    for (int i = 0; i < 16; i++)
+                        rgba[i][3] = channel[i];
+                    break;
+                case BlockFormat::BC5:
+                    for (int c = 0; c < 2; c++)
+                    {
+                        DecodeBC4Block(src + 8 * c, channel);
+                        for (int i = 0; i < 16; i++)
+                            rgba[i][c] = channel[i];
+                    }
+                    for (int i = 0; i < 16; i++)
+                    {
+                        rgba[i][2] = 0;
+                        rgba[i][3] = 255;
+                    }
+                    break;
+                default:
+                    DecodeBC7Block(src, rgba);
+                    break;
+                }
+                src += BlockBytes(image.block);
+
+                for (int y = 0; y < 4 && by * 4 + y < height; y++)
+                    for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+                        memcpy(dst + ((size_t)(by * 4 + y) * width + bx * 4 + x) * components, rgba[y * 4 + x], components);
+            }
+        }
+    }
+    return result;
+}
+#endif
@@ -0,0 +1,292 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/gl_object.h>
+#include <learnopengl/image_decoder.h>
+#include <learnopengl/mip_builder.h>
+#include <learnopengl/startup_trace.h>
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/texture_compression.h>
+#include <learnopengl/thread_pool.h>
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// a GL texture that may still be loading. id is what to bind: 0 or a placeholder until the upload is done.
+// The uploaded texture is deleted along with the slot, so the last handle has to be dropped on the GL thread
+// (AssetRegistry::CollectGarbage takes care of that for the handles it gave out).
+struct TextureSlot {
+    unsigned int id = 0;
+    bool ready = false;   // id is the real texture, owned by this slot
+    unsigned int lastBound = 0; // TextureFrame() of the last draw that bound it, see TextureResidency
+    TextureRole role = TextureRole::Colour; // how it was decoded, and is decoded again when it's reloaded
+    GLTexture texture;    // the texture id names once ready
+
+    // GL thread: takes ownership of an uploaded texture, deleting the one the slot had before
+    void Adopt(GLTexture uploaded)
+    {
+        id = uploaded;
+        texture = std::move(uploaded);
+        ready = true;
+    }
+    void Adopt(unsigned int uploaded) { Adopt(GLTexture(uploaded)); }
+};
+typedef shared_ptr<TextureSlot> TextureHandle;
+
+// frame number textures are aged by, advanced by TextureResidency::Update(). GL thread only.
+inline unsigned int &TextureFrame()
+{
+    static unsigned int frame = 0;
+    return frame;
+}
+
+// GL thread: binds the texture of handle (0 for none) to GL_TEXTURE_2D of the active unit and marks it as used in
+// this frame. Draws have to bind through this for TextureResidency to know which textures are in use.
+inline void BindTexture(const TextureHandle &handle)
+{
+    glBindTexture(GL_TEXTURE_2D, handle ? handle->id : 0);
+    if (handle)
+        handle->lastBound = TextureFrame();
+}
+
+// decodes an image file (or asset pack entry) into memory with the ImageDecoders(). Doesn't use OpenGL, so it may
+// run on a worker thread.
+inline ImageData DecodeImageFile(const string &filename)
+{
+    AssetBlob file = ReadAsset(filename);
+    if (!file)
+        return ImageData();
+    return DecodeImageMemory(file.data.get(), file.size);
+}
+
+// Like DecodeImageFile, but takes the cooked texture (with its mip chain) instead when asset_cook has made one
+// for the same role. Block compressed textures the driver can't sample are decoded back to plain texels. Uncooked images get their
+// mip chain built here, filtered for their role as asset_cook would (see MipSettingsFor).
+inline ImageData DecodeImage(const string &filename, TextureRole role = TextureRole::Colour)
+{
+    TraceScope scope("load image", filename);
+    ImageData image;
+    if (TextureCache::load(filename, CookSettingsFor(role), image))
+        return BlockFormatSupported(image.block) ? image : DecompressImage(image);
+    image = DecodeImageFile(filename);
+    if (!image.pixels)
+        return image;
+    TraceScope mips("build mips");
+    return BuildMipChain(image, MipSettingsFor(role));
+}
+
+// the format of 8 bit texels with components channels
+inline GLenum PixelFormat(int components)
+{
+    if (components == 1)
+        return GL_RED;
+    return components == 3 ? GL_RGB : GL_RGBA;
+}
+
+// GL thread: the usual sampling parameters for the bound GL_TEXTURE_2D holding image
+inline void TexSamplingFromImage(const ImageData &image)
+{
+    // a chain that stops short of 1x1 would otherwise leave the texture incomplete
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// GL thread: fills the bound GL_TEXTURE_2D from image, whose levels start at data (a PBO offset if one is bound),
+// and sets the usual sampling parameters. The mips are the image's own, the driver never generates any.
+inline void TexImageFromData(const ImageData &image, const unsigned char *data)
+{
+    GLenum format = PixelFormat(image.nrComponents);
+
+    // rows are tightly packed, which the default alignment of 4 doesn't allow for odd widths of RGB images
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = 0; level < image.levels; level++)
+    {
+        if (image.block != BlockFormat::None)
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, BlockInternalFormat(image.block), image.LevelWidth(level), image.LevelHeight(level), 0,
+                                   (GLsizei)image.LevelSize(level), data + image.LevelOffset(level));
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, format, image.LevelWidth(level), image.LevelHeight(level), 0, format, GL_UNSIGNED_BYTE,
+                         data + image.LevelOffset(level));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    TexSamplingFromImage(image);
+}
+
+// GL thread: gives the bound GL_TEXTURE_2D every level of image with undefined contents, to be filled by
+// TexSubImageRows, and sets the usual sampling parameters. No pixel unpack buffer may be bound.
+inline void TexStorageFromImage(const ImageData &image)
+{
+    GLenum format = PixelFormat(image.nrComponents);
+    for (int level = 0; level < image.levels; level++)
+    {
+        if (image.block != BlockFormat::None)
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, BlockInternalFormat(image.block), image.LevelWidth(level), image.LevelHeight(level), 0,
+                                   (GLsizei)image.LevelSize(level), nullptr);
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, format, image.LevelWidth(level), image.LevelHeight(level), 0, format, GL_UNSIGNED_BYTE, nullptr);
+    }
+    TexSamplingFromImage(image);
+}
+
+// rows of a level as partial uploads count them: texel rows, or rows of 4x4 blocks if the image is block compressed
+inline int UploadRows(const ImageData &image, int level)
+{
+    return image.block != BlockFormat::None ? (image.LevelHeight(level) + 3) / 4 : image.LevelHeight(level);
+}
+
+inline size_t UploadRowBytes(const ImageData &image, int level)
+{
+    return image.LevelSize(level) / UploadRows(image, level);
+}
+
+// GL thread: fills rowCount rows of level of the bound GL_TEXTURE_2D, from firstRow on (as UploadRows counts
+// them), from data, which holds just those rows (a PBO offset if one is bound). The texture must have its storage.
+inline void TexSubImageRows(const ImageData &image, int level, int firstRow, int rowCount, const unsigned char *data)
+{
+    int width = image.LevelWidth(level);
+    if (image.block != BlockFormat::None)
+    {
+        int top = firstRow * 4, height = min(image.LevelHeight(level), (firstRow + rowCount) * 4) - top;
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, top, width, height, BlockInternalFormat(image.block),
+                                  (GLsizei)(rowCount * UploadRowBytes(image, level)), data);
+        return;
+    }
+    GLenum format = PixelFormat(image.nrComponents);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, firstRow, width, rowCount, format, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// uploads a decoded image into a new texture object; an image that failed to decode yields an empty texture.
+inline unsigned int TextureFromImage(const ImageData &image, bool gamma = false)
+{
+    TraceScope scope("texture upload");
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    if (image.pixels)
+    {
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        TexImageFromData(image, image.pixels.get());
+    }
+
+    return textureID;
+}
+
+// anything models can get their material textures from
+class TextureSource
+{
+public:
+    virtual ~TextureSource() {}
+    // returns a handle for the texture at path, used as role; it may resolve later, once the texture is uploaded
+    virtual TextureHandle Request(const string &path, TextureRole role = TextureRole::Colour) = 0;
+    // texture to bind for one that hasn't been requested yet (see TextureLoading::OnFirstDraw)
+    virtual unsigned int Placeholder() const { return 0; }
+};
+
+// takes decoded images and uploads them over the following frames, see TextureStreamer
+class TextureUploadQueue
+{
+public:
+    virtual ~TextureUploadQueue() {}
+    // texture bound in place of the ones that are still on their way
+    virtual unsigned int Placeholder() const = 0;
+    virtual void Enqueue(const TextureHandle &handle, const ImageData &image, bool gamma) = 0;
+};
+
+// Collects texture requests, decodes the images in parallel on a thread pool and uploads them on the GL thread.
+// Request() never blocks: it hands out a handle whose id is filled in by UploadReady() or Finish() once the
+// image has been decoded and uploaded, or by the upload queue when one is given. The same path requested again
+// while its handle is alive shares it.
+class TextureLoader : public TextureSource
+{
+public:
+    // with a streamer, decoded images are handed to it instead of being uploaded synchronously
+    explicit TextureLoader(ThreadPool &pool, TextureUploadQueue *streamer = nullptr) : pool(pool), streamer(streamer) {}
+
+    // queues path for decoding; the returned handle resolves once the texture is uploaded
+    TextureHandle Request(const string &path, TextureRole role = TextureRole::Colour) override
+    {
+        auto found = requested.find(path);
+        if (found != requested.end())
+        {
+            if (TextureHandle handle = found->second.lock())
+                return handle;
+        }
+
+        PendingTexture texture;
+        texture.path = path;
+        texture.handle = make_shared<TextureSlot>();
+        texture.handle->id = streamer ? streamer->Placeholder() : 0;
+        texture.handle->role = role;
+        texture.image = pool.submit([path, role] { return DecodeImage(path, role); });
+        requested[path] = texture.handle;
+        pending.push_back(std::move(texture));
+        return pending.back().handle;
+    }
+
+    // GL thread: uploads every texture whose image has finished decoding, without waiting for the rest
+    void UploadReady()
+    {
+        upload(false);
+    }
+
+    // GL thread: waits for all outstanding decodes and uploads them (or hands them all to the upload queue)
+    void Finish()
+    {
+        upload(true);
+    }
+
+    size_t Pending() const { return pending.size(); }
+
+    unsigned int Placeholder() const override { return streamer ? streamer->Placeholder() : 0; }
+
+private:
+    struct PendingTexture {
+        string path;
+        TextureHandle handle;
+        future<ImageData> image;
+    };
+
+    ThreadPool &pool;
+    TextureUploadQueue *streamer;
+    vector<PendingTexture> pending;
+    map<string, weak_ptr<TextureSlot>> requested;
+
+    void upload(bool wait)
+    {
+        vector<PendingTexture> stillPending;
+        for (PendingTexture &texture : pending)
+        {
+            if (!wait && texture.image.wait_for(chrono::seconds(0)) != future_status::ready)
+            {
+                stillPending.push_back(std::move(texture));
+                continue;
+            }
+            ImageData image = texture.image.get();
+            if (!image.pixels)
+                std::cout << "Texture failed to load at path: " << texture.path << std::endl;
+            if (streamer)
+                streamer->Enqueue(texture.handle, image, texture.handle->role == TextureRole::Colour);
+            else if (image.pixels)
+            {
+                texture.handle->Adopt(TextureFromImage(image, texture.handle->role == TextureRole::Colour));
+            }
+        }
+        pending.swap(stillPending);
+    }
+};
+#endif
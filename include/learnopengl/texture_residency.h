@@ -0,0 +1,203 @@
+#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/texture_loader.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+using namespace std;
+
+// the levels of image from firstLevel down, as an image of their own; shares the pixels, nothing is copied
+inline ImageData MipTail(const ImageData &image, int firstLevel)
+{
+    ImageData tail = image;
+    firstLevel = max(0, min(firstLevel, image.levels - 1));
+    if (firstLevel == 0)
+        return tail;
+    tail.width = image.LevelWidth(firstLevel);
+    tail.height = image.LevelHeight(firstLevel);
+    tail.levels = image.levels - firstLevel;
+    tail.pixels = shared_ptr<unsigned char>(image.pixels, image.pixels.get() + image.LevelOffset(firstLevel));
+    return tail;
+}
+
+struct ResidencyStats {
+    size_t budgetBytes = 0;
+    size_t residentBytes = 0; // of the levels currently in GL textures
+    size_t fullBytes = 0;     // what the same textures would take with all their levels
+    unsigned int textures = 0;
+    unsigned int reducedTextures = 0; // textures held below their capped resolution
+    unsigned int evictions = 0;       // levels dropped so far
+    unsigned int restores = 0;        // levels streamed back in so far
+};
+
+// Keeps the textures uploaded by the TextureStreamer within a memory budget. Textures never get more than
+// MaxResidentSize texels on a side. Whenever the resident levels add up to more than BudgetBytes, Update()
+// drops the top level of the least recently bound textures (re-creating them from the image they were uploaded
+// from, which is kept for this) until they fit again, re-uploading at most EvictBytesPerFrame a frame; textures
+// bound in the last few frames get their levels back, RestoreBytesPerFrame at a time, while there is room. Draws
+// have to bind textures with BindTexture, which tells it what's in use. GL thread only.
+class TextureResidency
+{
+public:
+    size_t BudgetBytes;
+    int MaxResidentSize;                  // largest level kept resident, in texels on its longer side; 0 for no cap
+    int MinResidentSize = 64;             // evictions never go below this
+    unsigned int DemandFrames = 2;        // bound this recently counts as in use and may grow back
+    size_t RestoreBytesPerFrame = 4 * 1024 * 1024;
+    size_t EvictBytesPerFrame = 8 * 1024 * 1024; // what's still over the budget waits for the next frames
+
+    explicit TextureResidency(size_t budgetBytes = 256 * 1024 * 1024, int maxResidentSize = 0)
+        : BudgetBytes(budgetBytes), MaxResidentSize(maxResidentSize) {}
+
+    TextureResidency(const TextureResidency &) = delete;
+    TextureResidency &operator=(const TextureResidency &) = delete;
+
+    // first level of image to upload under the resolution cap
+    int FirstLevel(const ImageData &image) const
+    {
+        int level = 0;
+        while (MaxResidentSize > 0 && level + 1 < image.levels
+               && max(image.LevelWidth(level), image.LevelHeight(level)) > MaxResidentSize)
+            level++;
+        return level;
+    }
+
+    // takes over the texture of handle, whose levels from firstLevel on have been uploaded from image. A handle
+    // tracked already (its texture was reloaded) drops the image it had before.
+    void Track(const TextureHandle &handle, const ImageData &image, int firstLevel)
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->handle.lock() != handle)
+            {
+                ++it;
+                continue;
+            }
+            stats.residentBytes -= it->residentBytes();
+            it = entries.erase(it);
+        }
+        handle->lastBound = TextureFrame();
+        entries.push_back(Entry{ handle, image, firstLevel });
+        stats.residentBytes += MipTail(image, firstLevel).ByteSize();
+    }
+
+    // once per frame, before drawing: starts the next frame and moves levels in or out to meet the budget
+    void Update()
+    {
+        unsigned int frame = ++TextureFrame();
+        stats.residentBytes = 0;
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->handle.expired())
+                it = entries.erase(it);
+            else
+                stats.residentBytes += (it++)->residentBytes();
+        }
+
+        vector<Entry *> order(entries.size());
+        for (size_t i = 0; i < entries.size(); i++)
+            order[i] = &entries[i];
+
+        // over the budget, or above a cap that was lowered since: least recently bound first
+        sort(order.begin(), order.end(), [](const Entry *a, const Entry *b) { return a->lastBound() < b->lastBound(); });
+        size_t evicted = 0;
+        for (Entry *entry : order)
+        {
+            if (evicted >= EvictBytesPerFrame)
+                break;
+            int target = max(entry->firstLevel, FirstLevel(entry->image));
+            while (stats.residentBytes - entry->residentBytes() + MipTail(entry->image, target).ByteSize() > BudgetBytes
+                   && canDrop(*entry, target))
+                target++;
+            if (target != entry->firstLevel)
+            {
+                stats.evictions += target - entry->firstLevel;
+                evicted += MipTail(entry->image, target).ByteSize(); // the levels left are uploaded again
+                setFirstLevel(*entry, target);
+            }
+        }
+
+        // room left: textures in use get their levels back, most recently bound first
+        size_t restored = 0;
+        for (auto it = order.rbegin(); it != order.rend() && restored < RestoreBytesPerFrame; ++it)
+        {
+            Entry &entry = **it;
+            if (frame - entry.lastBound() > DemandFrames || entry.firstLevel <= FirstLevel(entry.image))
+                continue;
+            size_t grown = MipTail(entry.image, entry.firstLevel - 1).ByteSize();
+            if (stats.residentBytes - entry.residentBytes() + grown > BudgetBytes)
+                continue;
+            stats.restores++;
+            restored += grown;
+            setFirstLevel(entry, entry.firstLevel - 1);
+        }
+    }
+
+    ResidencyStats Stats() const
+    {
+        ResidencyStats result = stats;
+        result.budgetBytes = BudgetBytes;
+        for (const Entry &entry : entries)
+        {
+            if (entry.handle.expired())
+                continue;
+            result.textures++;
+            result.reducedTextures += entry.firstLevel > FirstLevel(entry.image);
+            result.fullBytes += entry.image.ByteSize();
+        }
+        return result;
+    }
+
+    // forgets every texture; their GL objects stay with their handles
+    void Release()
+    {
+        entries.clear();
+        stats.residentBytes = 0;
+    }
+
+private:
+    struct Entry {
+        weak_ptr<TextureSlot> handle;
+        ImageData image; // source of the levels; a cooked cache stays mapped rather than in memory
+        int firstLevel;
+
+        unsigned int lastBound() const
+        {
+            TextureHandle slot = handle.lock();
+            return slot ? slot->lastBound : 0;
+        }
+        size_t residentBytes() const { return MipTail(image, firstLevel).ByteSize(); }
+    };
+
+    vector<Entry> entries;
+    ResidencyStats stats;
+
+    bool canDrop(const Entry &entry, int level) const
+    {
+        return level + 1 < entry.image.levels
+               && max(entry.image.LevelWidth(level + 1), entry.image.LevelHeight(level + 1)) >= MinResidentSize;
+    }
+
+    // replaces the entry's texture with one holding the levels from level on
+    void setFirstLevel(Entry &entry, int level)
+    {
+        TextureHandle slot = entry.handle.lock();
+        if (!slot || !slot->ready)
+            return;
+        ImageData tail = MipTail(entry.image, level);
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        TexImageFromData(tail, tail.pixels.get());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        slot->Adopt(texture);
+
+        stats.residentBytes = stats.residentBytes - entry.residentBytes() + tail.ByteSize();
+        entry.firstLevel = level;
+    }
+};
+#endif
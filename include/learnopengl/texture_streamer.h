@@ -0,0 +1,300 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/startup_trace.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_residency.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+using namespace std;
+
+struct StreamerStats {
+    size_t queued = 0;           // decoded images waiting for their upload to start
+    size_t inFlight = 0;         // uploads started but not yet complete on the GPU
+    size_t bytesLastFrame = 0;   // pixel bytes copied during the last Update()
+    double msLastFrame = 0.0;    // time spent in the last Update()
+    size_t texturesCompleted = 0;
+};
+
+// Streams decoded images into textures through a ring of pixel buffer objects, spread over several frames.
+// Every frame Update() copies the next rows of the queued images into free PBOs until the per-frame byte or time
+// budget is used up and issues the texture uploads from them, so a large image is split over as many frames as its
+// size needs. The copy into the texture happens asynchronously on the GPU; a fence after the last rows of an
+// image tells when it's done, and only then the texture handle switches from the 1x1 placeholder to the real
+// texture, so sampling never waits on a transfer. Everything here must run on the GL thread.
+class TextureStreamer : public TextureUploadQueue
+{
+public:
+    size_t BytesPerFrame;
+    double MillisecondsPerFrame;
+    // with a residency manager, textures are uploaded under its resolution cap and handed to it once resident
+    TextureResidency *Residency = nullptr;
+
+    explicit TextureStreamer(size_t bytesPerFrame = 8 * 1024 * 1024, double millisecondsPerFrame = 2.0, unsigned int bufferCount = 4)
+        : BytesPerFrame(bytesPerFrame), MillisecondsPerFrame(millisecondsPerFrame), buffers(bufferCount)
+    {
+        for (PixelBuffer &buffer : buffers)
+            buffer.pbo = GLBuffer::Create();
+
+        // mid grey, so untextured meshes stay visible but obviously unfinished
+        const unsigned char grey[4] = { 128, 128, 128, 255 };
+        placeholder = GLTexture::Create();
+        glBindTexture(GL_TEXTURE_2D, placeholder);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // deletes the pixel buffers, fences, placeholder and the textures of unfinished uploads; call before the GL
+    // context goes away
+    void Release()
+    {
+        for (PixelBuffer &buffer : buffers)
+            buffer = PixelBuffer();
+        current = Current();
+        finishing.clear();
+        placeholder.Reset();
+        queue.clear();
+    }
+
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    // 1x1 texture bound in place of textures that are still streaming in
+    unsigned int Placeholder() const override { return placeholder; }
+
+    // queues a decoded image for upload; handle keeps pointing at the placeholder until it's resident. A handle
+    // that is already resident (a reloaded texture) keeps its old texture until then instead.
+    void Enqueue(const TextureHandle &handle, const ImageData &image, bool gamma = false) override
+    {
+        if (!handle->ready)
+            handle->id = placeholder;
+        if (!image.pixels)
+            return;
+        queue.push_back(Upload{ handle, image, gamma });
+    }
+
+    // once per frame: retires finished uploads and copies rows of the queued images within the budget
+    void Update()
+    {
+        auto start = chrono::steady_clock::now();
+        retire(false);
+
+        size_t bytes = 0;
+        while (current.texture || !queue.empty())
+        {
+            PixelBuffer *buffer = freeBuffer();
+            double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            // at least one row goes each frame, so the budget can't stall an upload
+            if (!buffer || (bytes > 0 && (bytes >= BytesPerFrame || elapsed > MillisecondsPerFrame)))
+                break;
+            if (!current.texture)
+            {
+                startUpload(queue.front());
+                queue.pop_front();
+            }
+            size_t copied = copyRows(*buffer, BytesPerFrame - bytes, bytes == 0);
+            if (copied == 0)
+                break;
+            bytes += copied;
+        }
+
+        stats.bytesLastFrame = bytes;
+        stats.msLastFrame = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    // uploads everything that is queued, ignoring the budget, and waits until it's all resident
+    void Flush()
+    {
+        while (current.texture || !queue.empty() || !finishing.empty())
+        {
+            PixelBuffer *buffer = freeBuffer();
+            if (buffer && (current.texture || !queue.empty()))
+            {
+                if (!current.texture)
+                {
+                    startUpload(queue.front());
+                    queue.pop_front();
+                }
+                copyRows(*buffer, SIZE_MAX, true);
+            }
+            else
+                retire(true);
+        }
+    }
+
+    StreamerStats Stats() const
+    {
+        StreamerStats result = stats;
+        result.queued = queue.size();
+        result.inFlight = finishing.size() + (current.texture ? 1 : 0);
+        return result;
+    }
+
+private:
+    struct Upload {
+        TextureHandle handle;
+        ImageData image;
+        bool gamma;
+    };
+
+    struct PixelBuffer {
+        GLBuffer pbo;
+        size_t capacity = 0;
+        GLFence fence; // behind the uploads that read the buffer
+    };
+
+    // the upload whose rows are being copied: the texture they go to and the next row
+    struct Current {
+        TextureHandle handle;
+        ImageData source;  // for the residency manager
+        ImageData image;   // the levels that are uploaded
+        int firstLevel = 0;
+        GLTexture texture;
+        int level = 0;
+        int row = 0;       // as UploadRows counts them
+    };
+
+    // a texture whose rows have all been issued, published once its fence has signalled
+    struct Finishing {
+        TextureHandle handle;
+        ImageData source;
+        int firstLevel;
+        GLTexture texture;
+        GLFence fence;
+    };
+
+    vector<PixelBuffer> buffers;
+    deque<Upload> queue;
+    Current current;
+    vector<Finishing> finishing;
+    GLTexture placeholder;
+    StreamerStats stats;
+
+    PixelBuffer *freeBuffer()
+    {
+        for (PixelBuffer &buffer : buffers)
+            if (!buffer.fence)
+                return &buffer;
+        return nullptr;
+    }
+
+    // makes the texture for the front of the queue, with storage for all of its levels, and starts at its top level
+    void startUpload(Upload &upload)
+    {
+        current = Current();
+        current.handle = upload.handle;
+        current.firstLevel = Residency ? Residency->FirstLevel(upload.image) : 0;
+        current.image = MipTail(upload.image, current.firstLevel);
+        if (Residency)
+            current.source = upload.image;
+        current.texture = GLTexture::Create();
+        glBindTexture(GL_TEXTURE_2D, current.texture);
+        TexStorageFromImage(current.image);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // copies the next rows of the current upload, no more than budget bytes of them but with oneRow at least one,
+    // into buffer and uploads them from there; the levels are stored back to back, so the rows are too. Returns
+    // the bytes copied, 0 if not even one row fit.
+    size_t copyRows(PixelBuffer &buffer, size_t budget, bool oneRow)
+    {
+        TraceScope scope("texture upload");
+        const ImageData &image = current.image;
+        struct Band {
+            int level, row, rows;
+        };
+        vector<Band> bands;
+        size_t first = image.LevelOffset(current.level) + current.row * UploadRowBytes(image, current.level), size = 0;
+        while (current.level < image.levels)
+        {
+            int left = UploadRows(image, current.level) - current.row;
+            size_t rowBytes = UploadRowBytes(image, current.level);
+            int rows = (int)min((size_t)left, (budget > size ? budget - size : 0) / rowBytes);
+            if (size == 0 && oneRow)
+                rows = max(rows, 1);
+            if (rows == 0)
+                break;
+            bands.push_back(Band{ current.level, current.row, rows });
+            size += rows * rowBytes;
+            current.row += rows;
+            if (current.row < UploadRows(image, current.level))
+                break;
+            current.level++;
+            current.row = 0;
+        }
+        if (bands.empty())
+            return 0;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+        // orphan the previous contents; the driver hands out fresh storage if the GPU still reads the old one
+        buffer.capacity = max(buffer.capacity, size);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, buffer.capacity, nullptr, GL_STREAM_DRAW);
+        void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        const unsigned char *src = image.pixels.get() + first;
+        if (dst)
+        {
+            memcpy(dst, src, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        else
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); // couldn't map it, upload straight from client memory instead
+
+        glBindTexture(GL_TEXTURE_2D, current.texture);
+        // with a PBO bound the data pointer is an offset into the buffer
+        const unsigned char *data = dst ? (const unsigned char *)0 : src;
+        for (const Band &band : bands)
+        {
+            TexSubImageRows(image, band.level, band.row, band.rows, data);
+            data += band.rows * UploadRowBytes(image, band.level);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        buffer.fence = GLFence::Insert();
+
+        if (current.level == image.levels)
+        {
+            finishing.push_back(Finishing{ current.handle, current.source, current.firstLevel, std::move(current.texture), GLFence::Insert() });
+            current = Current();
+        }
+        return size;
+    }
+
+    // frees the buffers the GPU is done with and publishes the textures whose upload has completed; with wait set
+    // blocks until at least one buffer or texture is done
+    void retire(bool wait)
+    {
+        const GLuint64 timeout = 1000000000ull;
+        for (PixelBuffer &buffer : buffers)
+        {
+            if (buffer.fence && buffer.fence.Signaled(wait ? timeout : 0))
+            {
+                buffer.fence.Reset();
+                wait = false;
+            }
+        }
+        for (auto it = finishing.begin(); it != finishing.end();)
+        {
+            if (!it->fence.Signaled(wait ? timeout : 0))
+            {
+                ++it;
+                continue;
+            }
+            wait = false;
+            it->handle->Adopt(std::move(it->texture));
+            if (Residency)
+                Residency->Track(it->handle, it->source, it->firstLevel);
+            it = finishing.erase(it);
+            stats.texturesCompleted++;
+        }
+    }
+};
+#endif
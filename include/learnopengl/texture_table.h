@@ -0,0 +1,95 @@
+#ifndef TEXTURE_TABLE_H
+#define TEXTURE_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Maps strings to small integer ids, so repeated lookups of the same path or type name compare and hash
+// integers instead of whole strings.
+class StringInterner
+{
+public:
+    uint32_t Intern(const std::string &value)
+    {
+        auto found = ids.find(value);
+        if (found != ids.end())
+            return found->second;
+        uint32_t id = (uint32_t)strings.size();
+        strings.push_back(value);
+        ids.emplace(value, id);
+        return id;
+    }
+
+    // id of an already interned string, or NotFound
+    uint32_t Find(const std::string &value) const
+    {
+        auto found = ids.find(value);
+        return found != ids.end() ? found->second : NotFound;
+    }
+
+    const std::string &Get(uint32_t id) const { return strings[id]; }
+
+    static const uint32_t NotFound = 0xffffffffu;
+
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> strings;
+};
+
+// Hash index of the material textures a model has loaded, keyed by (path, texture type). Replaces the linear
+// strcmp scan over the loaded textures, which was O(meshes x textures) for models with many materials.
+// Templated on the texture struct because the learnopengl and rg models each define their own.
+template<typename TextureT>
+class MaterialTextureTable
+{
+public:
+    // texture loaded from path for the given type, or nullptr
+    const TextureT *Find(const std::string &path, const std::string &type) const
+    {
+        uint32_t pathId = strings.Find(path);
+        uint32_t typeId = strings.Find(type);
+        if (pathId == StringInterner::NotFound || typeId == StringInterner::NotFound)
+            return nullptr;
+        auto found = textures.find(key(pathId, typeId));
+        return found != textures.end() ? &found->second : nullptr;
+    }
+
+    // any texture loaded from path regardless of its type, so an image used in several slots is loaded once
+    const TextureT *FindByPath(const std::string &path) const
+    {
+        uint32_t pathId = strings.Find(path);
+        if (pathId == StringInterner::NotFound)
+            return nullptr;
+        auto found = byPath.find(pathId);
+        return found != byPath.end() ? Find(path, strings.Get(found->second)) : nullptr;
+    }
+
+    void Insert(const std::string &path, const std::string &type, const TextureT &texture)
+    {
+        uint32_t pathId = strings.Intern(path);
+        uint32_t typeId = strings.Intern(type);
+        textures[key(pathId, typeId)] = texture;
+        byPath.emplace(pathId, typeId);
+    }
+
+    void Clear()
+    {
+        textures.clear();
+        byPath.clear();
+    }
+
+    size_t Size() const { return textures.size(); }
+
+private:
+    StringInterner strings;
+    std::unordered_map<uint64_t, TextureT> textures;
+    std::unordered_map<uint32_t, uint32_t> byPath; // path id -> type id of the first texture loaded from it
+
+    static uint64_t key(uint32_t pathId, uint32_t typeId)
+    {
+        return ((uint64_t)pathId << 32) | typeId;
+    }
+};
+#endif
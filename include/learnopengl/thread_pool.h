@@ -0,0 +1,93 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <learnopengl/startup_trace.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+// Fixed size pool of worker threads for CPU only work (file parsing, vertex conversion, image decoding).
+// Jobs must never touch OpenGL: the context is only current on the main thread.
+class ThreadPool
+{
+public:
+    // by default one worker per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+            threadCount = max(1u, thread::hardware_concurrency());
+        for (unsigned int i = 0; i < threadCount; i++)
+        {
+            workers.emplace_back([this, i] {
+                StartupTrace::Get().NameThread("pool worker " + to_string(i + 1));
+                workerLoop();
+            });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // queues a job and returns a future for its result; exceptions thrown by the job are rethrown by future::get.
+    template<typename F>
+    future<typename result_of<F()>::type> submit(F job)
+    {
+        typedef typename result_of<F()>::type Result;
+        auto task = make_shared<packaged_task<Result()>>(std::move(job));
+        future<Result> result = task->get_future();
+        {
+            lock_guard<mutex> lock(queueMutex);
+            jobs.push([task] { (*task)(); });
+        }
+        wakeUp.notify_one();
+        return result;
+    }
+
+    unsigned int size() const { return (unsigned int)workers.size(); }
+
+private:
+    vector<thread> workers;
+    queue<function<void()>> jobs;
+    mutex queueMutex;
+    condition_variable wakeUp;
+    bool stopping = false;
+
+    void workerLoop()
+    {
+        while (true)
+        {
+            function<void()> job;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                wakeUp.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+            job();
+        }
+    }
+};
+#endif
@@ -0,0 +1,13 @@
+#ifndef VERBOSE_H
+#define VERBOSE_H
+
+#include <atomic>
+
+// whether the loaders report the details of every import and upload (timings, sizes, optimizer statistics). Off by
+// default; main turns it on when the VERBOSE_LOADING environment variable is set. Failures are reported either way.
+inline std::atomic<bool> &VerboseLoading()
+{
+    static std::atomic<bool> verbose(false);
+    return verbose;
+}
+#endif
@@ -0,0 +1,150 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// layout of a mesh's vertex buffer
+enum class VertexFormat {
+    Full,    // Vertex: float position, normal, uv, tangent and bitangent, 56 bytes
+    Compact, // PackedVertex: quantized, 20 bytes
+};
+
+// Compact vertex, decoded in the vertex shader (see soba.vs):
+//   location 0  Position   unorm16 x4: xyz scaled into the mesh bounds, w is the bitangent sign (0 -> -1, 1 -> +1)
+//   location 1  Normal     snorm16 x2, octahedral
+//   location 2  TexCoords  half x2
+//   location 3  Tangent    snorm16 x2, octahedral; bitangent = cross(normal, tangent) * sign
+struct PackedVertex {
+    uint16_t Position[4];
+    int16_t  Normal[2];
+    uint16_t TexCoords[2];
+    int16_t  Tangent[2];
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+// per mesh transform from the unorm16 positions back to model space: position = offset + quantized * scale
+struct VertexQuantization {
+    glm::vec3 offset = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+// octahedral mapping of a unit vector to two snorm16 values (Cigolle et al. 2014)
+inline void OctEncode(const glm::vec3 &v, int16_t out[2])
+{
+    float sum = fabs(v.x) + fabs(v.y) + fabs(v.z);
+    float x = sum > 0.0f ? v.x / sum : 0.0f;
+    float y = sum > 0.0f ? v.y / sum : 0.0f;
+    if (v.z < 0.0f)
+    {
+        float foldedX = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    out[0] = (int16_t)lround(max(-1.0f, min(1.0f, x)) * 32767.0f);
+    out[1] = (int16_t)lround(max(-1.0f, min(1.0f, y)) * 32767.0f);
+}
+
+inline glm::vec3 OctDecode(const int16_t in[2])
+{
+    float x = max(in[0] / 32767.0f, -1.0f), y = max(in[1] / 32767.0f, -1.0f);
+    glm::vec3 v(x, y, 1.0f - fabs(x) - fabs(y));
+    if (v.z < 0.0f)
+    {
+        v.x = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        v.y = (1.0f - fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return glm::normalize(v);
+}
+
+// IEEE half precision with round to nearest even; out of range values become infinity
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t exponent = (bits >> 23) & 0xffu;
+    uint32_t mantissa = bits & 0x7fffffu;
+
+    if (exponent == 0xffu) // inf or nan
+        return (uint16_t)(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    int halfExponent = (int)exponent - 127 + 15;
+    if (halfExponent >= 31)
+        return (uint16_t)(sign | 0x7c00u);
+    if (halfExponent <= 0)
+    {
+        // subnormal half, or zero
+        if (halfExponent < -10)
+            return (uint16_t)sign;
+        mantissa |= 0x800000u;
+        int shift = 14 - halfExponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u)))
+            half++;
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = sign | ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+        half++; // may carry into the exponent, which rounds up to the next power of two or infinity as it should
+    return (uint16_t)half;
+}
+
+// a run of the index buffer drawn with one glDrawElementsBaseVertex call
+struct IndexRange {
+    unsigned int first = 0; // first index of the run
+    unsigned int count = 0;
+    int baseVertex = 0;     // added to every index of the run by the draw
+};
+
+// Converts triangle indices to 16 bits. The triangles are cut into runs that each reference a window of at most
+// 65536 vertices, stored relative to the start of their window; a mesh with fewer vertices is a single run.
+// Returns false, leaving narrow and ranges empty, if a single triangle spans more than that and the mesh needs
+// 32 bit indices.
+inline bool NarrowIndices(const vector<unsigned int> &indices, vector<uint16_t> &narrow, vector<IndexRange> &ranges)
+{
+    narrow.clear();
+    ranges.clear();
+    narrow.reserve(indices.size());
+    size_t begin = 0;
+    while (begin < indices.size())
+    {
+        unsigned int lower = UINT_MAX, upper = 0;
+        size_t end = begin;
+        for (; end + 3 <= indices.size(); end += 3)
+        {
+            unsigned int triangleLower = min(indices[end], min(indices[end + 1], indices[end + 2]));
+            unsigned int triangleUpper = max(indices[end], max(indices[end + 1], indices[end + 2]));
+            if (max(upper, triangleUpper) - min(lower, triangleLower) > 65535u)
+                break;
+            lower = min(lower, triangleLower);
+            upper = max(upper, triangleUpper);
+        }
+        if (end == begin)
+        {
+            narrow.clear();
+            ranges.clear();
+            return false;
+        }
+
+        IndexRange range;
+        range.first = (unsigned int)begin;
+        range.count = (unsigned int)(end - begin);
+        range.baseVertex = (int)lower;
+        for (size_t i = begin; i < end; i++)
+            narrow.push_back((uint16_t)(indices[i] - lower));
+        ranges.push_back(range);
+        begin = end;
+    }
+    return true;
+}
+#endif
@@ -9,6 +9,7 @@
 #include <string>
 #include <learnopengl/shader.h>
 #include <rg/mesh.h>
+#include <learnopengl/texture_table.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -20,6 +21,8 @@ public:
     std::vector<Texture> loaded_textures;
 
     std::string directory;
+    MaterialTextureTable<Texture> texture_index;
+
     Model(std::string path) {
 
         loadModel(path);
@@ -123,24 +126,22 @@ private:
             aiString str;
             mat->GetTexture(type, i, &str);
 
-            bool skip = false;
-
-            for (unsigned int j = 0; j < loaded_textures.size(); ++j) {
-                if (std::strcmp(str.C_Str(), loaded_textures[i].path.c_str()) == 0) {
-                    textures.push_back(loaded_textures[j]);
-                    skip = true;
-                    break;
-                }
+            if (const Texture* loaded = texture_index.Find(str.C_Str(), typeName)) {
+                textures.push_back(*loaded);
+                continue;
             }
 
-            if (!skip) {
-                Texture texture;
+            Texture texture;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            if (const Texture* loaded = texture_index.FindByPath(texture.path)) {
+                texture.id = loaded->id;
+            } else {
                 texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
                 loaded_textures.push_back(texture);
             }
+            textures.push_back(texture);
+            texture_index.Insert(texture.path, typeName, texture);
         }
 
     }
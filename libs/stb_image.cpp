@@ -1,2 +1,6 @@
+// SSE2 is picked up on its own on x86-64, NEON has to be asked for
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define STBI_NEON
+#endif
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
\ No newline at end of file
@@ -12,11 +12,26 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// compact vertex format (PackedVertex): positions are unorm16 inside the mesh bounds, normals octahedral
+uniform bool quantized;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
 void main()
 {
+    vec3 position = quantized ? positionOffset + aPos * positionScale : aPos;
+    vec3 normal = quantized ? octDecode(aNormal.xy) : aNormal;
 
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(model))) * normal;  
     TexCoords = aTexCoords;
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
@@ -13,7 +13,15 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
-
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/asset_registry.h>
+#include <learnopengl/file_watcher.h>
+#include <learnopengl/memory_usage.h>
+#include <learnopengl/startup_trace.h>
+#include <learnopengl/texture_streamer.h>
+#include <learnopengl/verbose.h>
+
+#include <cstdlib>
 #include <iostream>
 #include <math.h>
 
@@ -27,7 +35,6 @@ void processInput(GLFWwindow *window);
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
-unsigned int loadTexture(const char *path);
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
@@ -76,6 +83,9 @@ struct ProgramState {
     bool CameraMouseMovementUpdateEnabled = true;
     glm::vec3 backpackPosition = glm::vec3(0.0f);
     float backpackScale = 1.0f;
+    float lodErrorPixels = 1.0f;
+    bool clusterCulling = true;
+    ModelDrawStats drawStats; // of the last frame's model draws
     PointLight pointLight;
     ProgramState()
             : camera(glm::vec3(0.0f, 0.0f, -3.0f)) {}
@@ -116,18 +126,39 @@ void ProgramState::LoadFromFile(std::string filename) {
 }
 
 ProgramState *programState;
+AssetRegistry *assetRegistry;
+TextureStreamer *textureStreamer;
+TextureResidency *textureResidency;
 
 void DrawImGui(ProgramState *programState);
 
+// terminates glfw as main returns, after the shaders, models and textures declared later have deleted their GL
+// objects while the context was still there
+struct GlfwSession {
+    ~GlfwSession() { glfwTerminate(); }
+};
+
 glm::vec3 lightPos(0.0f, 8.0f, 0.0f);
 glm::vec3 lightSpotPos(0.0f,2.5f,-4.0f);
 
 bool isSpotlightActivated = false;
 
 int main() {
+    // times the phases of startup until the whole scene is on screen, see finishStartupTrace below
+    StartupTrace &startupTrace = StartupTrace::Get();
+    startupTrace.Start();
+    startupTrace.NameThread("main");
+    // per import details (timings, buffer sizes, optimizer statistics) only when asked for
+    VerboseLoading() = getenv("VERBOSE_LOADING") != nullptr;
+    // OBJ models through our own reader instead of Assimp, see ObjReaderEnabled
+    ObjReaderEnabled() = getenv("OBJ_READER") != nullptr;
+
     // glfw: initialize and configure
     // ------------------------------
+    TraceScope glfwInitScope("glfwInit");
     glfwInit();
+    glfwInitScope.End();
+    TraceScope windowScope("create window");
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -145,6 +176,7 @@ int main() {
         return -1;
     }
     glfwMakeContextCurrent(window);
+    GlfwSession glfwSession;
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
@@ -158,11 +190,15 @@ int main() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // cooked textures in block formats the driver lacks get decoded on load
+    DetectBlockFormats();
+    windowScope.End();
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     //ovo kad zakomentarisemo vis enam ne flipje teksturu
     //stbi_set_flip_vertically_on_load(true);
 
+    TraceScope imguiScope("ImGui init");
     programState = new ProgramState;
     programState->LoadFromFile("resources/program_state.txt");
     if (programState->ImGuiEnabled) {
@@ -178,6 +214,7 @@ int main() {
 
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330 core");
+    imguiScope.End();
 
     // configure global opengl state
     // -----------------------------
@@ -206,9 +243,41 @@ int main() {
     spotLight.cutOff = glm::cos(glm::radians(2.5f));
     spotLight.outerCutOff = glm::cos(glm::radians(21.5f));
 
+    size_t memoryBeforeLoading = ResidentMemoryBytes();
+    bool sceneLoaded = false;
+
+    TraceScope loadersScope("start loaders");
+    // a pack built by asset_cook --pack replaces the loose files; mounted before any loading starts
+    AssetPack::Mount(FileSystem::getPath("resources/assets.pak"), FileSystem::getPath(""));
+
+    // start importing the models on worker threads, they are parsed and decoded while the GL thread sets up the scene
+    ThreadPool loaderPool;
+    TextureStreamer streamer;
+    textureStreamer = &streamer;
+    // keeps the streamed textures within a VRAM budget, dropping mips of the ones not drawn lately
+    TextureResidency residency(256 * 1024 * 1024);
+    streamer.Residency = &residency;
+    textureResidency = &residency;
+    AssetRegistry assets(loaderPool, &streamer);
+    assetRegistry = &assets;
+    assets.ModelVertexFormat = VertexFormat::Compact; // soba.vs decodes it
+    assets.ModelRetention = CpuRetention::Release;    // nothing picks or collides against the models
+    // the material textures are only decoded once their mesh comes into view
+    assets.ModelTextureLoading = TextureLoading::OnFirstDraw;
+    assets.PrefetchModel(FileSystem::getPath("resources/objects/vagoni/train-cart.obj"));
+    assets.PrefetchModel(FileSystem::getPath("resources/objects/tenk/german-panzer-ww2-ausf-b.obj"));
+    loadersScope.End();
+
+    TraceScope shadersScope("shaders");
     Shader lightingShader("soba.vs", "soba.fs");
     Shader lightCubeShader("sijalica.vs", "sijalica.fs");
     Shader slikaShader("slika.vs", "slika.fs");
+    shadersScope.End();
+
+    // files saved under resources/ while the program runs are reloaded in place, see AssetRegistry::Reload
+    TraceScope watcherScope("watch resources");
+    FileWatcher watcher(FileSystem::getPath("resources"));
+    watcherScope.End();
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -324,10 +393,9 @@ int main() {
     };
 
 
-    unsigned int slikaVBO, VAO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &slikaVBO);
-    glGenBuffers(1, &EBO);
+    GLVertexArray VAO = GLVertexArray::Create();
+    GLBuffer slikaVBO = GLBuffer::Create();
+    GLBuffer EBO = GLBuffer::Create();
     // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
     glBindVertexArray(VAO);
 
@@ -355,11 +423,10 @@ int main() {
     glBindVertexArray(0);
 
     // first, configure the cube's VAO (and VBO)
-    unsigned int VBO, zidoviVAO,podVAO,plafonVAO;
-    glGenVertexArrays(1, &zidoviVAO);
-    glGenBuffers(1, &VBO);
+    GLVertexArray zidoviVAO = GLVertexArray::Create();
+    GLBuffer zidoviVBO = GLBuffer::Create();
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, zidoviVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices1), vertices1, GL_STATIC_DRAW);
 
     glBindVertexArray(zidoviVAO);
@@ -370,10 +437,10 @@ int main() {
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
-    glGenVertexArrays(1, &podVAO);
-    glGenBuffers(1, &VBO);
+    GLVertexArray podVAO = GLVertexArray::Create();
+    GLBuffer podVBO = GLBuffer::Create();
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, podVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices2), vertices2, GL_STATIC_DRAW);
 
     glBindVertexArray(podVAO);
@@ -384,10 +451,10 @@ int main() {
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
-    glGenVertexArrays(1, &plafonVAO);
-    glGenBuffers(1, &VBO);
+    GLVertexArray plafonVAO = GLVertexArray::Create();
+    GLBuffer plafonVBO = GLBuffer::Create();
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, plafonVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices3), vertices3, GL_STATIC_DRAW);
 
     glBindVertexArray(plafonVAO);
@@ -399,9 +466,8 @@ int main() {
     glEnableVertexAttribArray(2);
 
     // second, configure the light's VAO (VBO stays the same; the vertices are the same for the light object which is also a 3D cube)
-    unsigned int lightCubeVAO,lightCubeVBO;
-    glGenVertexArrays(1, &lightCubeVAO);
-    glGenBuffers(1, &lightCubeVBO);
+    GLVertexArray lightCubeVAO = GLVertexArray::Create();
+    GLBuffer lightCubeVBO = GLBuffer::Create();
 
     glBindBuffer(GL_ARRAY_BUFFER, lightCubeVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
@@ -413,34 +479,51 @@ int main() {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    // load textures (we now use a utility function to keep the code more organized)
-    // -----------------------------------------------------------------------------
-    unsigned int diffuseMap1 = loadTexture(FileSystem::getPath("resources/textures/cigle2.jpeg").c_str());
-    unsigned int specularMap1 = loadTexture(FileSystem::getPath("resources/textures/belo.png").c_str());
-    unsigned int diffuseMap2 = loadTexture(FileSystem::getPath("resources/textures/pod.jpeg").c_str());
-    unsigned int diffuseMap3 = loadTexture(FileSystem::getPath("resources/textures/plafon.png").c_str());
-    unsigned int diffuseMap4 = loadTexture(FileSystem::getPath("resources/textures/slika.jpeg").c_str());
-    unsigned int specularMap = loadTexture(FileSystem::getPath("resources/textures/boje.jpeg").c_str());
-
-    // shader configuration
+    // load textures (decoded in parallel on the loader pool, streamed in by the render loop)
+    // --------------------------------------------------------------------------------------
+    TraceScope texturesScope("request textures");
+    TextureHandle diffuseMap1 = assets.LoadTexture(FileSystem::getPath("resources/textures/cigle2.jpeg"));
+    TextureHandle specularMap1 = assets.LoadTexture(FileSystem::getPath("resources/textures/belo.png"));
+    TextureHandle diffuseMap2 = assets.LoadTexture(FileSystem::getPath("resources/textures/pod.jpeg"));
+    TextureHandle diffuseMap3 = assets.LoadTexture(FileSystem::getPath("resources/textures/plafon.png"));
+    TextureHandle diffuseMap4 = assets.LoadTexture(FileSystem::getPath("resources/textures/slika.jpeg"));
+    TextureHandle specularMap = assets.LoadTexture(FileSystem::getPath("resources/textures/boje.jpeg"));
+    texturesScope.End();
+
+    // shader configuration, again whenever a shader has been reloaded
     // --------------------
-    slikaShader.use();
-    slikaShader.setInt("material.diffuse",0);
-    slikaShader.setInt("material.specular",1);
-    lightingShader.use();
-    lightingShader.setInt("material.diffuse", 0);
-    lightingShader.setInt("material.specular",1);
+    auto configureShaders = [&]() {
+        slikaShader.use();
+        slikaShader.setInt("material.diffuse",0);
+        slikaShader.setInt("material.specular",1);
+        lightingShader.use();
+        lightingShader.setInt("material.diffuse", 0);
+        lightingShader.setInt("material.specular",1);
+    };
+    configureShaders();
 
     //ModelglEnable(GL_CULL_FACE);
 
-    Model vagon1Model(FileSystem::getPath("resources/objects/vagoni/train-cart.obj"));
-    Model vagon2Model(FileSystem::getPath("resources/objects/vagoni/train-cart.obj"));
-    Model tenkModel(FileSystem::getPath("resources/objects/tenk/german-panzer-ww2-ausf-b.obj"));
-
+    // GL phase of the model loads, only creates the buffers and textures
+    // the models are picked up by the render loop as soon as their import finishes
+    ModelHandle vagon1Model, vagon2Model, tenkModel;
+
+    // startup is over with the first frame that shows the whole scene (or when the window closes before that)
+    bool firstFramePresented = false;
+    auto finishStartupTrace = [&]() {
+        startupTrace.Finish();
+        std::string tracePath = FileSystem::getPath("startup_trace.json");
+        if (startupTrace.WriteChromeTrace(tracePath))
+            std::cout << "STARTUP:: trace written to " << tracePath << " (open it in chrome://tracing or ui.perfetto.dev)" << std::endl;
+        else
+            std::cout << "STARTUP:: can't write " << tracePath << std::endl;
+        startupTrace.PrintSummary();
+    };
 
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window)) {
+        TraceScope frameScope("frame");
         // per-frame time logic
         // --------------------
         float currentFrame = glfwGetTime();
@@ -451,6 +534,43 @@ int main() {
         // -----
         processInput(window);
 
+        // free whatever assets were released last frame
+        assets.CollectGarbage();
+
+        // pick up edited files: shaders are rebuilt right away, models and textures are reloaded in the background
+        // and swapped in once they're ready
+        bool shadersReloaded = false;
+        for (const std::string &file : watcher.Changed())
+        {
+            assets.Reload(file);
+            for (Shader *shader : { &lightingShader, &lightCubeShader, &slikaShader })
+                shadersReloaded |= shader->Uses(file) && shader->Reload();
+        }
+        if (shadersReloaded)
+            configureShaders();
+        assets.SwapReloaded();
+
+        // hand decoded textures to the streamer and upload as much as this frame's budget allows
+        assets.UploadReady();
+        streamer.Update();
+        residency.Update();
+
+        // models whose import hasn't finished yet are simply not drawn this frame
+        if (!vagon1Model)
+            vagon1Model = assets.LoadModel(FileSystem::getPath("resources/objects/vagoni/train-cart.obj"), false);
+        if (!vagon2Model)
+            vagon2Model = assets.LoadModel(FileSystem::getPath("resources/objects/vagoni/train-cart.obj"), false);
+        if (!tenkModel)
+            tenkModel = assets.LoadModel(FileSystem::getPath("resources/objects/tenk/german-panzer-ww2-ausf-b.obj"), false);
+
+        StreamerStats streaming = streamer.Stats();
+        if (!sceneLoaded && vagon1Model && vagon2Model && tenkModel && streaming.queued == 0 && streaming.inFlight == 0)
+        {
+            sceneLoaded = true;
+            std::cout << "MEMORY:: resident set " << memoryBeforeLoading / (1024 * 1024) << " MB before loading the scene, "
+                      << ResidentMemoryBytes() / (1024 * 1024) << " MB after" << std::endl;
+        }
+
 
         // render
         // ------
@@ -483,10 +603,10 @@ int main() {
 
 
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap4);
+        BindTexture(diffuseMap4);
 
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, specularMap);
+        BindTexture(specularMap);
 
         glBindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
@@ -510,15 +630,17 @@ int main() {
 
 
 
+        // the room is plain float vertices, only model meshes are quantized
+        lightingShader.setBool("quantized", false);
         // bind diffuse map
         lightingShader.setMat4("model", model);
         lightingShader.setFloat("material.shininess", 64.0f);
         lightingShader.setVec3("light.specular",0.02f,0.02f,0.02f);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap1);
+        BindTexture(diffuseMap1);
 
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, specularMap1);
+        BindTexture(specularMap1);
 
         // render the cube
         glBindVertexArray(zidoviVAO);
@@ -527,18 +649,18 @@ int main() {
 
         lightingShader.setVec3("light.specular",0.2f,0.2f,0.2f);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap3);
+        BindTexture(diffuseMap3);
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, specularMap1);
+        BindTexture(specularMap1);
 
         glBindVertexArray(plafonVAO);
         glDrawArrays(GL_TRIANGLES, 0, 6);
 
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap2);
+        BindTexture(diffuseMap2);
 
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, specularMap1);
+        BindTexture(specularMap1);
 
         lightingShader.setVec3("light.specular",0.6f,0.6f,0.6f);
         // render the cube
@@ -575,7 +697,18 @@ int main() {
         lightingShader.setMat4("model", modelTenk);
         lightingShader.setMat4("projection", projection);
         lightingShader.setMat4("view", view);
-        tenkModel.Draw(lightingShader);
+        programState->drawStats = ModelDrawStats();
+        // the models are drawn two-sided, so only the frustum test of the clusters applies, not the cone test
+        for (const ModelHandle &handle : { tenkModel, vagon1Model, vagon2Model })
+        {
+            if (handle)
+                handle->cullClusters = programState->clusterCulling;
+        }
+        if (tenkModel)
+        {
+            tenkModel->Draw(lightingShader, modelTenk, programState->camera, projection, (float)SCR_HEIGHT, programState->lodErrorPixels);
+            programState->drawStats.Add(tenkModel->DrawStats());
+        }
 
 
 
@@ -587,7 +720,11 @@ int main() {
         lightingShader.setMat4("model",modelvagon);
         lightingShader.setMat4("projection", projection);
         lightingShader.setMat4("view", view);
-        vagon1Model.Draw(lightingShader);
+        if (vagon1Model)
+        {
+            vagon1Model->Draw(lightingShader, modelvagon, programState->camera, projection, (float)SCR_HEIGHT, programState->lodErrorPixels);
+            programState->drawStats.Add(vagon1Model->DrawStats());
+        }
 
         modelvagon = glm::mat4(1.0f);
         modelvagon = glm::rotate(modelvagon,glm::radians(37.0f),glm::vec3(0.0f,1.0f,0.0f));
@@ -599,7 +736,11 @@ int main() {
         lightingShader.setMat4("model",modelvagon);
         lightingShader.setMat4("projection", projection);
         lightingShader.setMat4("view", view);
-        vagon1Model.Draw(lightingShader);
+        if (vagon2Model)
+        {
+            vagon2Model->Draw(lightingShader, modelvagon, programState->camera, projection, (float)SCR_HEIGHT, programState->lodErrorPixels);
+            programState->drawStats.Add(vagon2Model->DrawStats());
+        }
 
         glEnable(GL_CULL_FACE);
         glCullFace(GL_FRONT);
@@ -624,18 +765,34 @@ int main() {
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
+        TraceScope swapScope("glfwSwapBuffers");
         glfwSwapBuffers(window);
+        swapScope.End();
+        if (!firstFramePresented)
+        {
+            firstFramePresented = true;
+            startupTrace.Mark("first frame presented");
+        }
         glfwPollEvents();
+
+        if (sceneLoaded && startupTrace.Recording())
+        {
+            frameScope.End();
+            finishStartupTrace();
+        }
     }
+    if (startupTrace.Recording())
+        finishStartupTrace();
 
+    residency.Release();
+    streamer.Release();
     programState->SaveToFile("resources/program_state.txt");
     delete programState;
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
-    // glfw: terminate, clearing all previously allocated GLFW resources.
-    // ------------------------------------------------------------------
-    glfwTerminate();
+    // glfw: terminate, clearing all previously allocated GLFW resources (glfwSession, once everything above is gone).
+    // -------------------------------------------------------------------------------------------------------------
     return 0;
 }
 
@@ -719,6 +876,51 @@ void DrawImGui(ProgramState *programState) {
         ImGui::End();
     }
 
+    {
+        ImGui::Begin("Assets");
+        AssetStats stats = assetRegistry->Stats();
+        ImGui::Text("Models: %u resident, %u hits, %u misses", stats.residentModels, stats.modelHits, stats.modelMisses);
+        ImGui::Text("Textures: %u resident, %u hits, %u misses", stats.residentTextures, stats.textureHits, stats.textureMisses);
+        ImGui::Text("Vertex buffers: %.1f KB (%.1f KB as full floats)", stats.vertexBytes / 1024.0, stats.fullVertexBytes / 1024.0);
+        ImGui::Text("Textures not drawn yet: %u", stats.deferredTextures);
+        // reading /proc every frame costs more than the number is worth, a few samples a second are enough
+        static double residentSampled = -1.0;
+        static size_t residentBytes = 0;
+        if (residentSampled < 0.0 || glfwGetTime() - residentSampled >= 0.25)
+        {
+            residentBytes = ResidentMemoryBytes();
+            residentSampled = glfwGetTime();
+        }
+        ImGui::Text("Process memory: %.1f MB resident", residentBytes / (1024.0 * 1024.0));
+
+        const ModelDrawStats &draws = programState->drawStats;
+        ImGui::Text("Triangles: %zu of %zu drawn", draws.trianglesDrawn, draws.trianglesFull);
+        ImGui::Text("Meshes per level: %u / %u / %u / %u / %u, %u culled", draws.meshesPerLevel[0], draws.meshesPerLevel[1],
+                    draws.meshesPerLevel[2], draws.meshesPerLevel[3], draws.meshesPerLevel[4], draws.meshesCulled);
+        ImGui::DragFloat("LOD error (pixels)", &programState->lodErrorPixels, 0.05, 0.0, 16.0);
+        ImGui::Text("Clusters: %u of %u drawn", draws.clustersDrawn, draws.clustersTotal);
+        ImGui::Checkbox("Cluster culling", &programState->clusterCulling);
+
+        StreamerStats streaming = textureStreamer->Stats();
+        ImGui::Text("Streaming: %zu queued, %zu in flight, %zu done", streaming.queued, streaming.inFlight, streaming.texturesCompleted);
+        ImGui::Text("Last frame: %.1f KB in %.2f ms", streaming.bytesLastFrame / 1024.0, streaming.msLastFrame);
+        int budgetKb = (int)(textureStreamer->BytesPerFrame / 1024);
+        if (ImGui::DragInt("Upload budget (KB/frame)", &budgetKb, 64, 64, 65536))
+            textureStreamer->BytesPerFrame = (size_t)budgetKb * 1024;
+        ImGui::InputDouble("Upload budget (ms/frame)", &textureStreamer->MillisecondsPerFrame, 0.5, 1.0, "%.1f");
+
+        ResidencyStats residencyStats = textureResidency->Stats();
+        ImGui::Text("Texture memory: %.1f of %.1f MB (%.1f MB at full resolution)", residencyStats.residentBytes / (1024.0 * 1024.0),
+                    residencyStats.budgetBytes / (1024.0 * 1024.0), residencyStats.fullBytes / (1024.0 * 1024.0));
+        ImGui::Text("Textures: %u tracked, %u reduced, %u levels evicted, %u restored", residencyStats.textures,
+                    residencyStats.reducedTextures, residencyStats.evictions, residencyStats.restores);
+        int vramMb = (int)(textureResidency->BudgetBytes / (1024 * 1024));
+        if (ImGui::DragInt("VRAM budget (MB)", &vramMb, 1, 1, 4096))
+            textureResidency->BudgetBytes = (size_t)vramMb * 1024 * 1024;
+        ImGui::DragInt("Max texture size (0 = source)", &textureResidency->MaxResidentSize, 16, 0, 16384);
+        ImGui::End();
+    }
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
@@ -738,40 +940,3 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         }
     }
 }
-
-unsigned int loadTexture(char const * path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
-}
\ No newline at end of file
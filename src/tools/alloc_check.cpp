@@ -0,0 +1,199 @@
+// Allocation check: counts the heap allocations made while model data, meshes and models are moved and while a
+// model is built from imported data, and fails if any of them copies what it should only move. Moves have to
+// allocate nothing, and moving a model into a new one only the new one. Building a model may stage its geometry
+// once for the GL buffers, but never copy the vertex and index vectors on the way there. Needs an OpenGL context
+// for the upload and the moves of the built model; it makes a hidden window and skips those checks when it
+// can't. Registered with CTest.
+//
+// usage: alloc_check [--faces n]
+//   --faces n  triangles in the generated model (default 200000)
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <learnopengl/model.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+using namespace std;
+
+// only the allocations of the thread being checked count, not those of the pool's workers
+static thread_local bool counting = false;
+static thread_local size_t allocations = 0, allocatedBytes = 0;
+
+void *operator new(size_t size)
+{
+    if (counting)
+    {
+        allocations++;
+        allocatedBytes += size;
+    }
+    if (void *memory = malloc(size ? size : 1))
+        return memory;
+    throw bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+struct AllocationCount {
+    size_t allocations = 0;
+    size_t bytes = 0;
+};
+
+// the allocations the calling thread makes while running f
+template <typename F>
+static AllocationCount countAllocations(const F &f)
+{
+    allocations = allocatedBytes = 0;
+    counting = true;
+    f();
+    counting = false;
+    AllocationCount count;
+    count.allocations = allocations;
+    count.bytes = allocatedBytes;
+    return count;
+}
+
+static int failures = 0;
+
+static void report(const char *what, const AllocationCount &count, bool ok)
+{
+    printf("ALLOC_CHECK:: %-40s %6zu allocations %12zu bytes%s\n", what, count.allocations, count.bytes, ok ? "" : "   FAILED");
+    failures += !ok;
+}
+
+// writes a grid of about faces triangles, split into two objects so the model has more than one mesh; false if
+// the file can't be written
+static bool writeGrid(const string &path, size_t faces)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+    size_t cells = max((size_t)2, (size_t)sqrt(faces / 2.0));
+    for (size_t y = 0; y <= cells; y++)
+        for (size_t x = 0; x <= cells; x++)
+            fprintf(file, "v %zu %.4f %zu\nvt %.4f %.4f\n", x, sinf(x * 0.3f) * cosf(y * 0.3f), y, (float)x / cells, (float)y / cells);
+    for (size_t y = 0; y < cells; y++)
+    {
+        if (y == 0 || y == cells / 2)
+            fprintf(file, "o part_%zu\n", y);
+        for (size_t x = 0; x < cells; x++)
+        {
+            size_t a = y * (cells + 1) + x + 1, b = a + 1, c = a + cells + 1, d = c + 1;
+            fprintf(file, "f %zu/%zu %zu/%zu %zu/%zu\nf %zu/%zu %zu/%zu %zu/%zu\n", a, a, c, c, b, b, b, b, c, c, d, d);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+// a hidden window whose OpenGL context is current, or nullptr
+static GLFWwindow *makeContext()
+{
+    if (!glfwInit())
+        return nullptr;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "alloc_check", NULL, NULL);
+    if (!window)
+        return nullptr;
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress))
+    {
+        glfwDestroyWindow(window);
+        return nullptr;
+    }
+    return window;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t faces = 200000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--faces") == 0 && i + 1 < argc)
+            faces = (size_t)max(2LL, atoll(argv[++i]));
+    }
+
+    string path = "/tmp/alloc_check_" + to_string(getpid()) + ".obj";
+    if (!writeGrid(path, faces))
+    {
+        cout << "ALLOC_CHECK:: can't write " << path << endl;
+        return 1;
+    }
+    ModelData data = Model::Import(path);
+    remove(MeshCache::cachePathFor(path).c_str());
+    remove(path.c_str());
+    if (data.meshes.empty())
+    {
+        cout << "ALLOC_CHECK:: the generated model couldn't be imported" << endl;
+        return 1;
+    }
+    size_t geometryBytes = 0;
+    for (const CachedMesh &mesh : data.meshes)
+    {
+        geometryBytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+        for (const MeshLod &lod : mesh.lods)
+            geometryBytes += lod.indices.size() * sizeof(unsigned int);
+    }
+    printf("ALLOC_CHECK:: %zu meshes, %zu bytes of vertices and indices\n", data.meshes.size(), geometryBytes);
+
+    // the imported data on its way from the pool to the GL thread
+    ModelData moved;
+    AllocationCount count = countAllocations([&] { moved = std::move(data); });
+    report("move ModelData", count, count.allocations == 0);
+    vector<CachedMesh> meshes;
+    count = countAllocations([&] { meshes = std::move(moved.meshes); });
+    report("move the imported meshes", count, count.allocations == 0);
+    moved.meshes = std::move(meshes);
+
+    GLFWwindow *window = makeContext();
+    if (!window)
+    {
+        cout << "ALLOC_CHECK:: no OpenGL context, the upload and model checks are skipped" << endl;
+        return failures ? 1 : 0;
+    }
+    {
+        // the vertices and indices are staged once for the GL buffers, with the 16 bit indices narrowed on the
+        // way; a copy of the vectors besides would allocate as much again
+        unique_ptr<Model> model;
+        count = countAllocations([&] { model.reset(new Model(std::move(moved), false, VertexFormat::Full, CpuRetention::Full)); });
+        report("build a Model from ModelData", count, count.bytes < 2 * geometryBytes);
+
+        unique_ptr<Model> movedModel;
+        count = countAllocations([&] { movedModel.reset(new Model(std::move(*model))); });
+        report("move a Model into a new one", count, count.allocations == 1);
+        vector<Mesh> modelMeshes;
+        count = countAllocations([&] { modelMeshes = std::move(movedModel->meshes); });
+        report("move the meshes of a Model", count, count.allocations == 0);
+        count = countAllocations([&] { Mesh mesh(std::move(modelMeshes.back())); modelMeshes.back() = std::move(mesh); });
+        report("move a Mesh out and back", count, count.allocations == 0);
+    }
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    if (failures)
+        printf("ALLOC_CHECK:: %d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,316 @@
+// Offline asset cooker: imports every model under resources/objects and decodes every image under
+// resources/objects and resources/textures ahead of time, writing the same caches the runtime looks for
+// (<model>.meshcache and <image>.texcache, see MeshCache and TextureCache). After a cook the game starts without
+// running Assimp, the tangent generation, image decoding or mipmap generation. Mip chains are filtered in linear
+// light for colour textures (see BuildMipChain) and images are block compressed (see texture_compression.h):
+// BC5 for the normal maps of models, BC3 for images with alpha, BC1 for the rest.
+//
+// usage: asset_cook [--force] [--verbose] [--obj-reader] [--uncompressed | --bc7] [--pack file] [directory...]
+//   --force         rebuild every cache even if it's up to date. Not needed after a change of the compression,
+//                   of the role of an image or of its mip settings: caches cooked otherwise are rebuilt anyway
+//   --verbose       report the import of every model: timings, what the mesh optimizer achieved and the LOD
+//                   levels of every mesh
+//   --obj-reader    read OBJ models with ObjReader instead of Assimp, for a game run with OBJ_READER set
+//   --uncompressed  keep plain 8 bit texels in the image caches
+//   --bc7           compress colour images as BC7 instead of BC1/BC3: better quality, needs GL 4.2 or
+//                   ARB_texture_compression_bptc (the game decodes them on the CPU otherwise)
+//   --pack file     also pack the cooked assets and the shaders into one file (see AssetPack); the game mounts
+//                   resources/assets.pak if it exists
+//   directory       roots to cook instead of resources/objects and resources/textures
+
+#include <glad/glad.h>
+
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/filesystem.h>
+#include <learnopengl/mip_builder.h>
+#include <learnopengl/model.h>
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/texture_compression.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/thread_pool.h>
+
+#include <ftw.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+using namespace std;
+
+static vector<string> foundFiles;
+
+static int collectFile(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    if (type == FTW_F)
+        foundFiles.push_back(path);
+    return 0;
+}
+
+static string extensionOf(const string &path)
+{
+    size_t dot = path.find_last_of('.');
+    if (dot == string::npos || path.find('/', dot) != string::npos)
+        return "";
+    string extension = path.substr(dot + 1);
+    transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return extension;
+}
+
+static bool isImage(const string &path)
+{
+    static const set<string> extensions = { "jpg", "jpeg", "png", "tga", "bmp", "psd", "gif", "hdr", "pic" };
+    return extensions.count(extensionOf(path)) > 0;
+}
+
+static bool isModel(const string &path)
+{
+    string extension = extensionOf(path);
+    Assimp::Importer importer;
+    return !extension.empty() && !isImage(path) && extension != "mtl" && importer.IsExtensionSupported("." + extension);
+}
+
+// the runtime keys its caches by canonical path (see AssetRegistry::CanonicalPath), so the cooker has to as well
+static string canonicalPath(const string &path)
+{
+    char resolved[PATH_MAX];
+    return realpath(path.c_str(), resolved) ? string(resolved) : path;
+}
+
+struct CookResult {
+    bool ok = false;
+    bool cooked = false; // false if the cache was already up to date
+    size_t bytes = 0;
+};
+
+// how image caches are compressed
+enum class Compression {
+    Default, // BC1, or BC3 with alpha
+    None,
+    BC7,
+};
+
+static BlockFormat blockFormatFor(int components, TextureRole role, Compression compression)
+{
+    if (compression == Compression::None)
+        return BlockFormat::None;
+    if (role == TextureRole::NormalMap)
+        return BlockFormat::BC5;
+    if (compression == Compression::BC7)
+        return BlockFormat::BC7;
+    return components == 2 || components == 4 ? BlockFormat::BC3 : BlockFormat::BC1;
+}
+
+// textures collects the canonical paths of the model's textures, each with what it's used for
+static CookResult cookModel(const string &path, bool force, vector<pair<string, TextureRole>> &textures)
+{
+    CookResult result;
+    string cachePath = MeshCache::cachePathFor(path);
+    if (force)
+        remove(cachePath.c_str());
+    struct stat before, after;
+    bool existed = stat(cachePath.c_str(), &before) == 0;
+
+    // Import reads a valid cache, or runs Assimp and writes a fresh one
+    ModelData data = Model::Import(path);
+    for (const CachedMesh &mesh : data.meshes)
+    {
+        for (const Texture &texture : mesh.textures)
+            textures.emplace_back(canonicalPath(data.directory + '/' + texture.path), TextureRoleFor(texture.type));
+        result.bytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+    }
+    result.ok = !data.meshes.empty();
+    // rewritten caches get a new inode from the rename
+    result.cooked = stat(cachePath.c_str(), &after) == 0 && (!existed || after.st_ino != before.st_ino);
+    return result;
+}
+
+// an image cache is up to date if its source is unchanged, its mips were filtered for the role the image has now
+// with the current MipSettings (TextureCache::load checks both) and it has the block format we'd compress it to
+static bool imageCacheUpToDate(const string &path, TextureRole role, Compression compression, ImageData &image)
+{
+    return TextureCache::load(path, CookSettingsFor(role), image) && image.block == blockFormatFor(image.nrComponents, role, compression);
+}
+
+static CookResult cookImage(const string &path, bool force, TextureRole role, Compression compression)
+{
+    CookResult result;
+    ImageData image;
+    if (!force && imageCacheUpToDate(path, role, compression, image))
+    {
+        result.ok = true;
+        result.bytes = image.ByteSize();
+        return result;
+    }
+
+    image = DecodeImageFile(path);
+    if (!image.pixels)
+    {
+        cout << "ERROR::ASSET_COOK:: failed to decode " << path << endl;
+        return result;
+    }
+    image = CompressImage(BuildMipChain(image, MipSettingsFor(role)), blockFormatFor(image.nrComponents, role, compression));
+    result.ok = TextureCache::store(path, CookSettingsFor(role), image);
+    if (!result.ok)
+        cout << "ERROR::ASSET_COOK:: failed to write " << TextureCache::cachePathFor(path) << endl;
+    result.cooked = true;
+    result.bytes = image.ByteSize();
+    return result;
+}
+
+static bool fileExists(const string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+// packs everything under the roots and the shaders. Sources with a cache are left out, the runtime never
+// opens them when the cache is there; a temporary file of an interrupted write or an older pack are skipped too.
+static bool writePack(const string &packPath, const vector<string> &roots, const set<string> &cookedImages)
+{
+    string root = canonicalPath(FileSystem::getPath(""));
+    foundFiles.clear();
+    for (const string &directory : roots)
+        nftw(directory.c_str(), collectFile, 16, FTW_PHYS);
+    nftw(FileSystem::getPath("resources/shaders").c_str(), collectFile, 16, FTW_PHYS);
+
+    set<string> files(cookedImages.begin(), cookedImages.end());
+    for (const string &file : foundFiles)
+        files.insert(canonicalPath(file));
+
+    vector<string> names;
+    for (const string &file : files)
+    {
+        string extension = extensionOf(file);
+        if (file.find(".tmp") != string::npos || extension == "pak")
+            continue;
+        if (isImage(file) && fileExists(TextureCache::cachePathFor(file)))
+            continue;
+        if (isModel(file) && fileExists(MeshCache::cachePathFor(file)))
+            continue;
+        if (file.compare(0, root.size() + 1, root + "/") != 0)
+        {
+            cout << "WARNING::ASSET_COOK:: " << file << " is outside of " << root << ", not packed" << endl;
+            continue;
+        }
+        names.push_back(file.substr(root.size() + 1));
+    }
+
+    if (!AssetPack::Write(packPath, root, names, true))
+        return false;
+    cout << "ASSET_COOK:: packed " << names.size() << " files into " << packPath << endl;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    bool force = false;
+    Compression compression = Compression::Default;
+    string packPath;
+    vector<string> roots;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--force") == 0)
+            force = true;
+        else if (strcmp(argv[i], "--verbose") == 0)
+            VerboseLoading() = true;
+        else if (strcmp(argv[i], "--obj-reader") == 0)
+            ObjReaderEnabled() = true;
+        else if (strcmp(argv[i], "--uncompressed") == 0)
+            compression = Compression::None;
+        else if (strcmp(argv[i], "--bc7") == 0)
+            compression = Compression::BC7;
+        else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+            packPath = argv[++i];
+        else
+            roots.push_back(argv[i]);
+    }
+    if (roots.empty())
+    {
+        roots.push_back(FileSystem::getPath("resources/objects"));
+        roots.push_back(FileSystem::getPath("resources/textures"));
+    }
+
+    auto start = chrono::steady_clock::now();
+    for (const string &root : roots)
+    {
+        if (nftw(root.c_str(), collectFile, 16, FTW_PHYS) != 0)
+            cout << "WARNING::ASSET_COOK:: couldn't walk " << root << endl;
+    }
+
+    set<string> models, images;
+    map<string, TextureRole> roles;
+    for (const string &file : foundFiles)
+    {
+        if (isImage(file))
+            images.insert(canonicalPath(file));
+        else if (isModel(file))
+            models.insert(canonicalPath(file));
+    }
+
+    ThreadPool pool;
+    unsigned int failed = 0, cooked = 0;
+    size_t bytes = 0;
+
+    // models first: their materials may reference images outside the cooked roots
+    vector<future<CookResult>> modelJobs;
+    vector<vector<pair<string, TextureRole>>> modelTextures(models.size());
+    size_t index = 0;
+    for (const string &model : models)
+    {
+        vector<pair<string, TextureRole>> *textures = &modelTextures[index++];
+        modelJobs.push_back(pool.submit([model, force, textures] { return cookModel(model, force, *textures); }));
+    }
+    for (size_t i = 0; i < modelJobs.size(); i++)
+    {
+        CookResult result = modelJobs[i].get();
+        failed += !result.ok;
+        cooked += result.cooked;
+        bytes += result.bytes;
+        for (const auto &texture : modelTextures[i])
+        {
+            images.insert(texture.first);
+            TextureRole &role = roles[texture.first];
+            role = max(role, texture.second);
+        }
+    }
+
+    set<string> cookedImages; // caches of every image that has one, including ones outside the roots
+    vector<pair<string, future<CookResult>>> imageJobs;
+    for (const string &image : images)
+    {
+        TextureRole role = roles.count(image) ? roles[image] : TextureRole::Colour;
+        imageJobs.emplace_back(image, pool.submit([image, force, role, compression] { return cookImage(image, force, role, compression); }));
+    }
+    for (auto &job : imageJobs)
+    {
+        CookResult result = job.second.get();
+        failed += !result.ok;
+        cooked += result.cooked;
+        bytes += result.bytes;
+        if (result.cooked && result.ok)
+            cout << "ASSET_COOK:: cooked " << job.first << endl;
+        if (result.ok)
+            cookedImages.insert(TextureCache::cachePathFor(job.first));
+    }
+
+    if (!packPath.empty() && !writePack(packPath, roots, cookedImages))
+    {
+        cout << "ERROR::ASSET_COOK:: failed to write " << packPath << endl;
+        failed++;
+    }
+
+    cout << "ASSET_COOK:: " << models.size() << " models, " << images.size() << " images, " << cooked << " rebuilt, "
+         << failed << " failed, " << bytes / (1024 * 1024) << " MB of cooked data in "
+         << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+// Block compression check: encodes small images that are hard on the encoders of texture_compression.h with
+// every block format, decodes them again and fails if a block comes back further from the original than its
+// format allows. Covers blocks whose texels all sum to the same value, which the principal axis search used to
+// encode as one solid colour. Runs without a GL context; registered with CTest.
+//
+// usage: bc_check
+
+#include <learnopengl/texture_compression.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+struct Case {
+    string name;
+    int components;
+    vector<unsigned char> texels; // 4 x 4, components per texel
+};
+
+// a 4 x 4 image whose texel i is texel(i)
+template <typename Texel>
+static Case makeCase(const string &name, int components, const Texel &texel)
+{
+    Case block;
+    block.name = name;
+    block.components = components;
+    for (int i = 0; i < 16; i++)
+    {
+        unsigned char value[4];
+        texel(i, value);
+        block.texels.insert(block.texels.end(), value, value + components);
+    }
+    return block;
+}
+
+// mean difference per texel and channel of the decoded block, over the channels the format keeps
+static double meanError(const Case &block, const ImageData &decoded, int channels)
+{
+    double sum = 0.0;
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < channels; c++)
+            sum += abs((int)block.texels[i * block.components + c] - (int)decoded.pixels.get()[i * decoded.nrComponents + c]);
+    return sum / (16.0 * channels);
+}
+
+int main()
+{
+    vector<Case> cases;
+    // r + g + b is the same for every texel: colour changes only across the grey axis
+    cases.push_back(makeCase("red to green", 3, [](int i, unsigned char *t) { t[0] = (unsigned char)(i * 17); t[1] = (unsigned char)(255 - i * 17); t[2] = 0; }));
+    cases.push_back(makeCase("red and cyan", 3, [](int i, unsigned char *t) {
+        t[0] = i % 2 ? 240 : 0; t[1] = t[2] = i % 2 ? 0 : 120; }));
+    cases.push_back(makeCase("blue to yellow", 4, [](int i, unsigned char *t) {
+        t[0] = t[1] = (unsigned char)(i * 8); t[2] = (unsigned char)(240 - i * 16); t[3] = 255; }));
+    // r + g + b + a is the same for every texel, for the four dimensional search of BC7
+    cases.push_back(makeCase("red to transparent", 4, [](int i, unsigned char *t) {
+        t[0] = (unsigned char)(i * 17); t[1] = t[2] = 0; t[3] = (unsigned char)(255 - i * 17); }));
+    // and an ordinary gradient, which never had the problem
+    cases.push_back(makeCase("grey ramp", 3, [](int i, unsigned char *t) { t[0] = t[1] = t[2] = (unsigned char)(i * 17); }));
+
+    struct Format {
+        BlockFormat format;
+        int channels;     // compared channels: BC5 keeps red and green only
+        double allowed;   // mean error per channel in 1/255ths
+    };
+    const Format formats[] = {
+        { BlockFormat::BC1, 3, 24.0 },
+        { BlockFormat::BC3, 4, 24.0 },
+        { BlockFormat::BC5, 2, 12.0 },
+        { BlockFormat::BC7, 4, 8.0 },
+    };
+
+    int failures = 0;
+    for (const Case &block : cases)
+    {
+        ImageData image;
+        image.width = image.height = 4;
+        image.nrComponents = block.components;
+        image.pixels = shared_ptr<unsigned char>(new unsigned char[block.texels.size()], default_delete<unsigned char[]>());
+        memcpy(image.pixels.get(), block.texels.data(), block.texels.size());
+        for (const Format &format : formats)
+        {
+            ImageData decoded = DecompressImage(CompressImage(image, format.format));
+            int channels = min(format.channels, block.components);
+            double error = decoded.pixels ? meanError(block, decoded, channels) : 1e9;
+            bool failed = error > format.allowed;
+            printf("BC_CHECK:: %-20s %-4s mean error %6.2f%s\n", block.name.c_str(), BlockFormatName(format.format), error,
+                   failed ? "   FAILED" : "");
+            failures += failed;
+        }
+    }
+    if (failures)
+        printf("BC_CHECK:: %d blocks encoded worse than their format allows\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+// Image decoder benchmark: decodes every JPEG under resources/objects with each backend of ImageDecoders() that
+// reads JPEGs, and reports its throughput in MB of files read and MB of texels written per second, over the
+// fastest of a few runs. Also checks that the backends agree on the images they produced.
+//
+// usage: decode_bench [--runs n] [directory or file...]
+//   --runs n   runs of each decoder over all files, the fastest counts (default 5)
+//   directory  roots to look for .jpg and .jpeg files in instead of resources/objects
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/image_decoder.h>
+
+#include <ftw.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+using namespace std;
+
+static vector<string> foundFiles;
+
+static int collectFile(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    if (type == FTW_F)
+        foundFiles.push_back(path);
+    return 0;
+}
+
+static bool isJpeg(const string &path)
+{
+    size_t dot = path.find_last_of('.');
+    if (dot == string::npos || path.find('/', dot) != string::npos)
+        return false;
+    string extension = path.substr(dot + 1);
+    transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return extension == "jpg" || extension == "jpeg";
+}
+
+struct JpegFile {
+    string path;
+    vector<unsigned char> data;
+};
+
+// mean difference of the texels of two decodes of the same image, in 1/255ths; -1 if their shapes differ
+static double meanDifference(const ImageData &a, const ImageData &b)
+{
+    if (!a.pixels || !b.pixels || a.width != b.width || a.height != b.height || a.nrComponents != b.nrComponents)
+        return -1.0;
+    size_t size = a.ByteSize();
+    double sum = 0.0;
+    for (size_t i = 0; i < size; i++)
+        sum += abs((int)a.pixels.get()[i] - (int)b.pixels.get()[i]);
+    return sum / size;
+}
+
+int main(int argc, char *argv[])
+{
+    int runs = 5;
+    vector<string> roots;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = max(1, atoi(argv[++i]));
+        else
+            roots.push_back(argv[i]);
+    }
+    if (roots.empty())
+        roots.push_back(FileSystem::getPath("resources/objects"));
+
+    for (const string &root : roots)
+    {
+        if (nftw(root.c_str(), collectFile, 16, FTW_PHYS) != 0)
+            cout << "BENCH:: couldn't walk " << root << endl;
+    }
+    vector<JpegFile> files;
+    size_t fileBytes = 0;
+    for (const string &path : foundFiles)
+    {
+        if (!isJpeg(path))
+            continue;
+        ifstream stream(path, ios::binary);
+        JpegFile file;
+        file.path = path;
+        file.data.assign(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+        fileBytes += file.data.size();
+        files.push_back(std::move(file));
+    }
+    if (files.empty())
+    {
+        cout << "BENCH:: no JPEGs found" << endl;
+        return 1;
+    }
+    printf("BENCH:: %zu JPEGs, %.1f MB\n", files.size(), fileBytes / (1024.0 * 1024.0));
+
+    // the first decoder's images, the others are compared against them
+    vector<ImageData> reference;
+    const char *referenceName = nullptr;
+    for (const ImageDecoder *decoder : ImageDecoders())
+    {
+        if (!decoder->Accepts(files.front().data.data(), files.front().data.size()))
+            continue;
+        vector<ImageData> images(files.size());
+        size_t texelBytes = 0;
+        double best = 1e30;
+        for (int run = 0; run < runs; run++)
+        {
+            texelBytes = 0;
+            auto start = chrono::steady_clock::now();
+            for (size_t i = 0; i < files.size(); i++)
+            {
+                images[i] = decoder->Decode(files[i].data.data(), files[i].data.size());
+                texelBytes += images[i].pixels ? images[i].ByteSize() : 0;
+            }
+            best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+
+        unsigned int failed = 0;
+        double difference = 0.0;
+        bool mismatch = false;
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            if (!images[i].pixels)
+            {
+                cout << "BENCH::   " << decoder->Name() << " can't decode " << files[i].path << endl;
+                failed++;
+            }
+            else if (!reference.empty())
+            {
+                double imageDifference = meanDifference(reference[i], images[i]);
+                mismatch |= imageDifference < 0.0 && reference[i].pixels;
+                difference = max(difference, imageDifference);
+            }
+        }
+
+        printf("BENCH:: %-20s %8.1f ms   %7.1f MB/s read   %7.1f MB/s of texels", decoder->Name(), best * 1000.0,
+               fileBytes / (1024.0 * 1024.0) / best, texelBytes / (1024.0 * 1024.0) / best);
+        if (failed)
+            printf("   %u failed", failed);
+        if (mismatch)
+            printf("   images of other sizes than %s's", referenceName);
+        else if (!reference.empty())
+            printf("   texels differ from %s's by up to %.2f/255 on average", referenceName, difference);
+        printf("\n");
+        if (reference.empty())
+        {
+            reference = std::move(images);
+            referenceName = decoder->Name();
+        }
+    }
+    return 0;
+}
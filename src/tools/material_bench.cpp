@@ -0,0 +1,191 @@
+// Material benchmark: writes an OBJ with --materials materials, each on its own quad with a diffuse map of its
+// own and a specular map shared with other materials, and reports how long importing it takes: Model::Import
+// from the file and from its mesh cache, and Assimp alone. Then times finding the distinct textures of the
+// imported meshes, as Model::loadMaterialTexture does, with MaterialTextureTable and with the linear strcmp scan
+// it replaced.
+//
+// usage: material_bench [--materials n] [--runs n]
+//   --materials n  materials in the generated model (default 5000)
+//   --runs n       runs of each measurement, the fastest counts (default 3)
+
+#include <glad/glad.h>
+
+#include <learnopengl/model.h>
+#include <learnopengl/texture_table.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// materials sharing each specular map
+static const unsigned int SpecularShare = 10;
+
+// writes the model and its material library to path and path's .mtl; false if they can't be written
+static bool writeModel(const string &path, const string &library, unsigned int materials)
+{
+    FILE *mtl = fopen(library.c_str(), "w");
+    if (!mtl)
+        return false;
+    for (unsigned int i = 0; i < materials; i++)
+        fprintf(mtl, "newmtl material_%u\nKd 0.8 0.8 0.8\nmap_Kd diffuse_%u.png\nmap_Ks specular_%u.png\n\n", i, i, i / SpecularShare);
+    if (fclose(mtl) != 0)
+        return false;
+
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+    string name = library.substr(library.find_last_of('/') + 1);
+    fprintf(file, "# %u materials written by material_bench\nmtllib %s\n", materials, name.c_str());
+    for (unsigned int i = 0; i < materials; i++)
+    {
+        float x = (float)(i % 100), z = (float)(i / 100);
+        fprintf(file, "v %g 0 %g\nv %g 0 %g\nv %g 0 %g\nv %g 0 %g\n", x, z, x + 1, z, x + 1, z + 1, x, z + 1);
+    }
+    fprintf(file, "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvn 0 1 0\n");
+    for (unsigned int i = 0; i < materials; i++)
+    {
+        unsigned int v = i * 4 + 1;
+        fprintf(file, "o quad_%u\nusemtl material_%u\n", i, i);
+        fprintf(file, "f %u/1/1 %u/4/1 %u/3/1\nf %u/1/1 %u/3/1 %u/2/1\n", v, v + 3, v + 2, v, v + 2, v + 1);
+    }
+    return fclose(file) == 0;
+}
+
+// best time in milliseconds of runs calls of run, which returns false on failure
+template <typename Run>
+static double bestOf(int runs, const Run &run)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = chrono::steady_clock::now();
+        if (!run())
+            return -1.0;
+        best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+// the lookups loadMaterialTexture makes for every texture of every mesh, through the hash index; returns the
+// number of distinct images
+static size_t dedupHashed(const vector<CachedMesh> &meshes)
+{
+    MaterialTextureTable<Texture> index;
+    size_t loaded = 0;
+    for (const CachedMesh &mesh : meshes)
+    {
+        for (const Texture &texture : mesh.textures)
+        {
+            if (index.Find(texture.path, texture.type))
+                continue;
+            if (const Texture *shared = index.FindByPath(texture.path))
+            {
+                Texture copy = *shared;
+                copy.type = texture.type;
+                index.Insert(texture.path, texture.type, copy);
+                continue;
+            }
+            index.Insert(texture.path, texture.type, texture);
+            loaded++;
+        }
+    }
+    return loaded;
+}
+
+// the same with the strcmp scan over the loaded textures that Model used before
+static size_t dedupLinear(const vector<CachedMesh> &meshes)
+{
+    vector<Texture> loaded;
+    for (const CachedMesh &mesh : meshes)
+    {
+        for (const Texture &texture : mesh.textures)
+        {
+            bool skip = false;
+            for (size_t j = 0; j < loaded.size(); j++)
+            {
+                if (strcmp(loaded[j].path.data(), texture.path.c_str()) == 0)
+                {
+                    skip = true;
+                    break;
+                }
+            }
+            if (!skip)
+                loaded.push_back(texture);
+        }
+    }
+    return loaded.size();
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int materials = 5000;
+    int runs = 3;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--materials") == 0 && i + 1 < argc)
+            materials = (unsigned int)max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = max(1, atoi(argv[++i]));
+    }
+
+    string base = "/tmp/material_bench_" + to_string(getpid());
+    string path = base + ".obj", library = base + ".mtl";
+    cout << "BENCH:: writing " << materials << " materials to " << path << endl;
+    if (!writeModel(path, library, materials))
+    {
+        cout << "BENCH:: can't write " << path << endl;
+        return 1;
+    }
+
+    // without the cache every run imports the file again
+    ModelData data;
+    double coldMs = bestOf(runs, [&] {
+        remove(MeshCache::cachePathFor(path).c_str());
+        data = Model::Import(path);
+        return !data.meshes.empty();
+    });
+    double warmMs = bestOf(runs, [&] {
+        data = Model::Import(path);
+        return !data.meshes.empty();
+    });
+    vector<CachedMesh> assimp;
+    double assimpMs = bestOf(runs, [&] {
+        assimp.clear();
+        return Model::ReadMeshes(path, assimp, false);
+    });
+
+    size_t textures = 0;
+    for (const CachedMesh &mesh : data.meshes)
+        textures += mesh.textures.size();
+    size_t hashedImages = 0, linearImages = 0;
+    double hashedMs = bestOf(runs, [&] { hashedImages = dedupHashed(data.meshes); return true; });
+    double linearMs = bestOf(runs, [&] { linearImages = dedupLinear(data.meshes); return true; });
+
+    remove(MeshCache::cachePathFor(path).c_str());
+    remove(path.c_str());
+    remove(library.c_str());
+
+    if (coldMs < 0.0 || warmMs < 0.0)
+    {
+        cout << "BENCH:: the model couldn't be imported" << endl;
+        return 1;
+    }
+    printf("BENCH:: %zu meshes, %zu material textures, %zu distinct images\n", data.meshes.size(), textures, hashedImages);
+    printf("BENCH::   Model::Import %9.1f ms   from the mesh cache %9.1f ms\n", coldMs, warmMs);
+    if (assimpMs < 0.0)
+        printf("BENCH::   Assimp couldn't read it\n");
+    else
+        printf("BENCH::   Assimp alone %9.1f ms\n", assimpMs);
+    printf("BENCH::   texture lookups: hashed %9.3f ms   linear scan %9.3f ms   %.0fx\n", hashedMs, linearMs, linearMs / max(hashedMs, 1e-6));
+    if (hashedImages != linearImages)
+        printf("BENCH::   the lookups found different images: %zu hashed, %zu scanned\n", hashedImages, linearImages);
+    return 0;
+}
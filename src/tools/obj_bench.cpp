@@ -0,0 +1,178 @@
+// OBJ import benchmark: reads Wavefront OBJ files with ObjReader and with Assimp (Model::ReadMeshes without the
+// fast path), reports the best time of each over a few runs and checks that both produced the same meshes.
+// Without files it uses the Panzer from resources/objects and a generated grid of --faces triangles.
+//
+// usage: obj_bench [--threads n] [--faces n] [--runs n] [file.obj...]
+//   --threads n  threads ObjReader parses with (default: every hardware thread)
+//   --faces n    triangles in the generated grid (default 10000000, 0 to skip it)
+//   --runs n     runs of each reader per file, the fastest counts (default 3)
+
+#include <glad/glad.h>
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/model.h>
+#include <learnopengl/obj_reader.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// writes a square grid of about faces triangles with positions, texture coordinates and normals, as an exporter
+// would; false if the file can't be written
+static bool writeGrid(const string &path, size_t faces)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+    size_t cells = max((size_t)1, (size_t)sqrt(faces / 2.0));
+    fprintf(file, "# %zu x %zu grid written by obj_bench\no grid\n", cells, cells);
+    for (size_t y = 0; y <= cells; y++)
+    {
+        for (size_t x = 0; x <= cells; x++)
+        {
+            float u = (float)x / cells, v = (float)y / cells;
+            fprintf(file, "v %.6f %.6f %.6f\n", u * 100.0f, 0.5f * sinf(u * 40.0f) * cosf(v * 40.0f), v * 100.0f);
+        }
+    }
+    for (size_t y = 0; y <= cells; y++)
+        for (size_t x = 0; x <= cells; x++)
+            fprintf(file, "vt %.6f %.6f\n", (float)x / cells, (float)y / cells);
+    for (size_t y = 0; y <= cells; y++)
+    {
+        for (size_t x = 0; x <= cells; x++)
+        {
+            float u = (float)x / cells, v = (float)y / cells;
+            float dx = 0.2f * cosf(u * 40.0f) * cosf(v * 40.0f), dz = -0.2f * sinf(u * 40.0f) * sinf(v * 40.0f);
+            float length = sqrtf(dx * dx + 1.0f + dz * dz);
+            fprintf(file, "vn %.6f %.6f %.6f\n", -dx / length, 1.0f / length, -dz / length);
+        }
+    }
+    for (size_t y = 0; y < cells; y++)
+    {
+        for (size_t x = 0; x < cells; x++)
+        {
+            size_t a = y * (cells + 1) + x + 1, b = a + 1, c = a + cells + 1, d = c + 1;
+            fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, c, c, c, b, b, b);
+            fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", b, b, b, c, c, c, d, d, d);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+// largest difference between the two imports, or -1 if their mesh, vertex or index counts differ
+static float compareMeshes(const vector<CachedMesh> &a, const vector<CachedMesh> &b, float &tangentDifference)
+{
+    if (a.size() != b.size())
+        return -1.0f;
+    float difference = 0.0f;
+    tangentDifference = 0.0f;
+    for (size_t m = 0; m < a.size(); m++)
+    {
+        if (a[m].vertices.size() != b[m].vertices.size() || a[m].indices != b[m].indices)
+            return -1.0f;
+        for (size_t i = 0; i < a[m].vertices.size(); i++)
+        {
+            const Vertex &x = a[m].vertices[i], &y = b[m].vertices[i];
+            difference = max(difference, glm::length(x.Position - y.Position));
+            difference = max(difference, glm::length(x.Normal - y.Normal));
+            difference = max(difference, glm::length(x.TexCoords - y.TexCoords));
+            tangentDifference = max(tangentDifference, max(glm::length(x.Tangent - y.Tangent), glm::length(x.Bitangent - y.Bitangent)));
+        }
+    }
+    return difference;
+}
+
+// best time in milliseconds of runs imports; meshes holds the last one
+template <typename Import>
+static double bestOf(int runs, vector<CachedMesh> &meshes, const Import &import)
+{
+    double best = 1e30;
+    for (int run = 0; run < runs; run++)
+    {
+        meshes.clear();
+        auto start = chrono::steady_clock::now();
+        if (!import(meshes))
+            return -1.0;
+        best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static void benchmark(const string &path, unsigned int threads, int runs)
+{
+    vector<CachedMesh> fast, assimp;
+    double fastMs = bestOf(runs, fast, [&](vector<CachedMesh> &meshes) { return ObjReader::Read(path, meshes, threads); });
+    double assimpMs = bestOf(runs, assimp, [&](vector<CachedMesh> &meshes) { return Model::ReadMeshes(path, meshes, false); });
+    size_t vertices = 0, triangles = 0;
+    for (const CachedMesh &mesh : fast)
+    {
+        vertices += mesh.vertices.size();
+        triangles += mesh.indices.size() / 3;
+    }
+
+    cout << "BENCH:: " << path << ": " << vertices << " vertices, " << triangles << " triangles" << endl;
+    if (fastMs < 0.0 || assimpMs < 0.0)
+    {
+        cout << "BENCH::   " << (fastMs < 0.0 ? "ObjReader" : "Assimp") << " failed to read it" << endl;
+        return;
+    }
+    float tangentDifference;
+    float difference = compareMeshes(fast, assimp, tangentDifference);
+    printf("BENCH::   ObjReader %9.1f ms   Assimp %9.1f ms   %.1fx\n", fastMs, assimpMs, assimpMs / fastMs);
+    if (difference < 0.0f)
+        printf("BENCH::   the readers produced different meshes or triangles\n");
+    else
+        printf("BENCH::   largest difference: %g in positions, normals and texture coordinates, %g in tangents\n",
+               difference, tangentDifference);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int threads = 0;
+    size_t faces = 10000000;
+    int runs = 3;
+    vector<string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = (unsigned int)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--faces") == 0 && i + 1 < argc)
+            faces = (size_t)atoll(argv[++i]);
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = max(1, atoi(argv[++i]));
+        else
+            files.push_back(argv[i]);
+    }
+
+    string grid;
+    if (files.empty())
+    {
+        files.push_back(FileSystem::getPath("resources/objects/tenk/german-panzer-ww2-ausf-b.obj"));
+        if (faces > 0)
+        {
+            grid = "/tmp/obj_bench_grid_" + to_string(getpid()) + ".obj";
+            cout << "BENCH:: writing a grid of " << faces << " triangles to " << grid << endl;
+            if (!writeGrid(grid, faces))
+            {
+                cout << "BENCH:: can't write " << grid << endl;
+                return 1;
+            }
+            files.push_back(grid);
+        }
+    }
+
+    for (const string &file : files)
+        benchmark(file, threads, runs);
+    if (!grid.empty())
+        remove(grid.c_str());
+    return 0;
+}
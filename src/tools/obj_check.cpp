@@ -0,0 +1,170 @@
+// OBJ reader check: writes a small OBJ and material library with what ObjReader has to get right (quads, objects
+// and groups, material changes inside an object, relative indices and an object without normals or texture
+// coordinates), reads it with ObjReader and with Assimp (Model::ReadMeshes without the fast path) and fails if the
+// meshes differ in count, triangles, materials or by more than the tolerances below in any vertex. ObjReader stays
+// an opt-in (see ObjReaderEnabled) until this passes. Runs without a GL context; registered with CTest.
+//
+// usage: obj_check [file.obj...]
+//   file.obj  check these files too, e.g. the models under resources/objects
+
+#include <glad/glad.h>
+
+#include <learnopengl/model.h>
+#include <learnopengl/obj_reader.h>
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+
+// largest differences allowed: positions and texture coordinates come straight from the file, normals and tangents
+// are computed, by code that sums in a different order
+static const float PositionTolerance = 1e-5f;
+static const float NormalTolerance = 1e-3f;
+static const float TangentTolerance = 1e-2f;
+
+// writes the model and its material library; false if they can't be written
+static bool writeModel(const string &path, const string &library)
+{
+    FILE *mtl = fopen(library.c_str(), "w");
+    if (!mtl)
+        return false;
+    fprintf(mtl, "newmtl painted\nKd 0.8 0.1 0.1\nmap_Kd painted.png\nmap_Ks painted_specular.png\n\n");
+    fprintf(mtl, "newmtl metal\nKd 0.5 0.5 0.5\nmap_Kd metal.png\nmap_Bump metal_normal.png\n\n");
+    fprintf(mtl, "newmtl plain\nKd 1 1 1\n");
+    if (fclose(mtl) != 0)
+        return false;
+
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+    string name = library.substr(library.find_last_of('/') + 1);
+    fprintf(file, "# written by obj_check\nmtllib %s\n", name.c_str());
+    // a 4 x 4 height field with texture coordinates and normals
+    for (int y = 0; y < 4; y++)
+        for (int x = 0; x < 4; x++)
+            fprintf(file, "v %d %.3f %d\nvt %.3f %.3f\nvn %.4f 0.9 %.4f\n", x, 0.25f * ((x * 7 + y * 3) % 4), y, x / 3.0f, y / 3.0f,
+                    0.1f * x - 0.15f, 0.1f * y - 0.15f);
+    // quads, with a material change half way
+    fprintf(file, "o plate\nusemtl painted\n");
+    for (int y = 0; y < 3; y++)
+    {
+        if (y == 2)
+            fprintf(file, "usemtl metal\n");
+        for (int x = 0; x < 3; x++)
+        {
+            int a = y * 4 + x + 1, b = a + 1, c = a + 5, d = a + 4;
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+        }
+    }
+    // a group with triangles, back on the first material
+    fprintf(file, "g rim\nusemtl painted\nf 1/1/1 5/5/5 2/2/2\nf 4/4/4 3/3/3 8/8/8\n");
+    // relative indices into vertices written just before
+    fprintf(file, "o fan\nusemtl plain\nv 10 0 0\nv 11 0 0\nv 11 1 0\nv 10 1 0\nv 10.5 0.5 1\nvt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvn 0 0 1\n");
+    fprintf(file, "f -5/-4/-1 -4/-3/-1 -3/-2/-1 -2/-1/-1\nf -5/-4/-1 -1/-2/-1 -4/-3/-1\n");
+    // positions only: normals are generated, and there are no texture coordinates to build tangents from
+    fprintf(file, "o bare\nv 20 0 0\nv 22 0 0\nv 22 0 2\nv 20 0 2\nv 21 1.5 1\n");
+    fprintf(file, "f -5 -1 -4\nf -4 -1 -3\nf -3 -1 -2\nf -2 -1 -5\nf -5 -4 -3 -2\n");
+    return fclose(file) == 0;
+}
+
+// the largest difference between a and b, also when one of them is NaN
+static float difference(const glm::vec3 &a, const glm::vec3 &b)
+{
+    float d = glm::length(a - b);
+    return d == d ? d : INFINITY;
+}
+
+// what differs between the two reads, or an empty string if nothing beyond the tolerances
+static string compare(const vector<CachedMesh> &fast, const vector<CachedMesh> &assimp)
+{
+    char message[256];
+    if (fast.size() != assimp.size())
+    {
+        snprintf(message, sizeof(message), "%zu meshes against %zu", fast.size(), assimp.size());
+        return message;
+    }
+    for (size_t m = 0; m < fast.size(); m++)
+    {
+        const CachedMesh &a = fast[m], &b = assimp[m];
+        if (a.vertices.size() != b.vertices.size() || a.indices != b.indices)
+        {
+            snprintf(message, sizeof(message), "mesh %zu: %zu vertices and %zu indices against %zu and %zu", m, a.vertices.size(),
+                     a.indices.size(), b.vertices.size(), b.indices.size());
+            return message;
+        }
+        if (a.textures.size() != b.textures.size())
+        {
+            snprintf(message, sizeof(message), "mesh %zu: %zu textures against %zu", m, a.textures.size(), b.textures.size());
+            return message;
+        }
+        for (size_t t = 0; t < a.textures.size(); t++)
+        {
+            if (a.textures[t].type != b.textures[t].type || a.textures[t].path != b.textures[t].path)
+            {
+                snprintf(message, sizeof(message), "mesh %zu: texture %s %s against %s %s", m, a.textures[t].type.c_str(),
+                         a.textures[t].path.c_str(), b.textures[t].type.c_str(), b.textures[t].path.c_str());
+                return message;
+            }
+        }
+        for (size_t i = 0; i < a.vertices.size(); i++)
+        {
+            const Vertex &x = a.vertices[i], &y = b.vertices[i];
+            const char *what = nullptr;
+            if (!(difference(x.Position, y.Position) <= PositionTolerance)
+                || !(difference(glm::vec3(x.TexCoords.x, x.TexCoords.y, 0.0f), glm::vec3(y.TexCoords.x, y.TexCoords.y, 0.0f)) <= PositionTolerance))
+                what = "position or texture coordinates";
+            else if (!(difference(x.Normal, y.Normal) <= NormalTolerance))
+                what = "normal";
+            else if (!(difference(x.Tangent, y.Tangent) <= TangentTolerance) || !(difference(x.Bitangent, y.Bitangent) <= TangentTolerance))
+                what = "tangent";
+            if (what)
+            {
+                snprintf(message, sizeof(message), "mesh %zu vertex %zu: the %s differs", m, i, what);
+                return message;
+            }
+        }
+    }
+    return "";
+}
+
+static bool check(const string &path)
+{
+    vector<CachedMesh> fast, assimp;
+    bool fastRead = ObjReader::Read(path, fast), assimpRead = Model::ReadMeshes(path, assimp, false);
+    string problem;
+    if (!fastRead || !assimpRead)
+        problem = string(fastRead ? "Assimp" : "ObjReader") + " couldn't read it";
+    else
+        problem = compare(fast, assimp);
+    size_t triangles = 0;
+    for (const CachedMesh &mesh : assimp)
+        triangles += mesh.indices.size() / 3;
+    printf("OBJ_CHECK:: %s: %zu meshes, %zu triangles%s%s\n", path.c_str(), assimp.size(), triangles, problem.empty() ? "" : "   FAILED: ",
+           problem.c_str());
+    return problem.empty();
+}
+
+int main(int argc, char *argv[])
+{
+    string base = "/tmp/obj_check_" + to_string(getpid());
+    string path = base + ".obj", library = base + ".mtl";
+    if (!writeModel(path, library))
+    {
+        printf("OBJ_CHECK:: can't write %s\n", path.c_str());
+        return 1;
+    }
+    int failures = !check(path);
+    remove(path.c_str());
+    remove(library.c_str());
+    for (int i = 1; i < argc; i++)
+        failures += !check(argv[i]);
+
+    if (failures)
+        printf("OBJ_CHECK:: %d files read differently by ObjReader and Assimp\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+// Mesh optimizer check: runs OptimizeMesh from mesh_optimizer.h over small meshes that are hard on its passes and
+// fails if a mesh comes back with triangles missing, added or turned around. Covers meshes that start with a
+// degenerate triangle, which the overdraw pass used to drop together with every triangle up to the first cold
+// cache boundary. Runs without a GL context; registered with CTest.
+//
+// usage: optimizer_check
+
+#include <learnopengl/mesh_optimizer.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
+using namespace std;
+
+struct Case {
+    string name;
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+};
+
+static Vertex makeVertex(float x, float y, float z)
+{
+    Vertex vertex = {};
+    vertex.Position = glm::vec3(x, y, z);
+    vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+    vertex.TexCoords = glm::vec2(x, y);
+    return vertex;
+}
+
+// a cells x cells grid, one vertex per face corner as Assimp emits them for OBJ files
+static Case makeGrid(const string &name, int cells)
+{
+    Case grid;
+    grid.name = name;
+    for (int y = 0; y < cells; y++)
+    {
+        for (int x = 0; x < cells; x++)
+        {
+            const float corners[6][2] = { {0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1} };
+            for (const float *corner : corners)
+            {
+                grid.indices.push_back((unsigned int)grid.vertices.size());
+                grid.vertices.push_back(makeVertex(x + corner[0], y + corner[1], 0.0f));
+            }
+        }
+    }
+    return grid;
+}
+
+// the triangles of a mesh by position, each rotated to start at its smallest corner so the winding is kept, sorted
+static vector<array<float, 9>> triangles(const vector<Vertex> &vertices, const vector<unsigned int> &indices)
+{
+    vector<array<float, 9>> result;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        array<array<float, 3>, 3> corners;
+        for (int c = 0; c < 3; c++)
+        {
+            const glm::vec3 &p = vertices[indices[t + c]].Position;
+            corners[c] = { { p.x, p.y, p.z } };
+        }
+        rotate(corners.begin(), min_element(corners.begin(), corners.end()), corners.end());
+        array<float, 9> triangle;
+        for (int c = 0; c < 3; c++)
+            copy(corners[c].begin(), corners[c].end(), triangle.begin() + c * 3);
+        result.push_back(triangle);
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+int main()
+{
+    vector<Case> cases;
+    // a first triangle with a repeated corner misses the cache only twice
+    Case degenerate;
+    degenerate.name = "degenerate first triangle";
+    for (int i = 0; i < 6; i++)
+        degenerate.vertices.push_back(makeVertex((float)(i % 3), (float)(i / 3), 0.0f));
+    degenerate.indices = { 0, 0, 1, 0, 1, 4, 0, 4, 3, 1, 2, 5, 1, 5, 4 };
+    cases.push_back(degenerate);
+
+    Case grid = makeGrid("grid", 24);
+    cases.push_back(grid);
+
+    Case degenerateGrid = grid;
+    degenerateGrid.name = "grid after a degenerate triangle";
+    degenerateGrid.indices.insert(degenerateGrid.indices.begin(), { 0, 0, 1 });
+    cases.push_back(degenerateGrid);
+
+    Case scattered = grid;
+    scattered.name = "grid with degenerate triangles";
+    for (size_t t = 0; t < scattered.indices.size(); t += 3 * 7)
+        scattered.indices[t + 1] = scattered.indices[t];
+    cases.push_back(scattered);
+
+    // a cube of separate faces: every face starts cold
+    Case cube;
+    cube.name = "cube";
+    for (int face = 0; face < 6; face++)
+    {
+        int axis = face / 2;
+        float side = face % 2 ? 1.0f : 0.0f;
+        unsigned int first = (unsigned int)cube.vertices.size();
+        for (int corner = 0; corner < 4; corner++)
+        {
+            float p[3];
+            p[axis] = side;
+            p[(axis + 1) % 3] = (float)(corner & 1);
+            p[(axis + 2) % 3] = (float)(corner >> 1);
+            cube.vertices.push_back(makeVertex(p[0], p[1], p[2]));
+        }
+        cube.indices.insert(cube.indices.end(), { first, first + 1, first + 3, first, first + 3, first + 2 });
+    }
+    cases.push_back(cube);
+
+    int failures = 0;
+    for (Case &mesh : cases)
+    {
+        vector<array<float, 9>> before = triangles(mesh.vertices, mesh.indices);
+        OptimizeMesh(mesh.vertices, mesh.indices);
+        vector<array<float, 9>> after = triangles(mesh.vertices, mesh.indices);
+        bool failed = mesh.indices.size() % 3 != 0 || before != after;
+        printf("OPTIMIZER_CHECK:: %-34s %5zu triangles in %5zu out%s\n", mesh.name.c_str(), before.size(), mesh.indices.size() / 3,
+               failed ? "   FAILED" : "");
+        failures += failed;
+    }
+    if (failures)
+        printf("OPTIMIZER_CHECK:: %d meshes changed their triangles\n", failures);
+    return failures ? 1 : 0;
+}